@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "AtlasBuilder.hpp"
+#include "vendor/stb_image.h"
+
+// imgui_draw.cpp compiles its own copy static, so this one is private as well
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "vendor/imgui/imstb_rectpack.h"
+
+static int nextPowerOfTwo(int value)
+{
+    int result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+
+// Copies `image` to (x, y) of `page` and repeats its outer rows and columns `padding` pixels outwards
+static void blitExtruded(std::vector<unsigned char>& page, int pageWidth,
+                         const unsigned char* pixels, int width, int height, int x, int y, int padding)
+{
+    for (int row = -padding; row < height + padding; row++)
+    {
+        const unsigned char* source = pixels + (size_t)std::min(std::max(row, 0), height - 1) * width * 4;
+        unsigned char* destination = &page[((size_t)(y + row) * pageWidth + x) * 4];
+
+        for (int column = -padding; column < 0; column++)
+            memcpy(destination + column * 4, source, 4);
+
+        memcpy(destination, source, (size_t)width * 4);
+
+        for (int column = width; column < width + padding; column++)
+            memcpy(destination + column * 4, source + (width - 1) * 4, 4);
+    }
+}
+
+AtlasBuilder::AtlasBuilder(int pageSize, int padding)
+:   m_PageSize(pageSize),
+    m_Padding(padding)
+{
+}
+
+bool AtlasBuilder::Add(const std::string& filepath)
+{
+    int width, height, channels;
+    stbi_set_flip_vertically_on_load(1);
+    unsigned char* pixels = stbi_load(filepath.c_str(), &width, &height, &channels, 4);
+
+    if (!pixels)
+    {
+        std::cout << "[AtlasBuilder] Could not load " << filepath << ": " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    bool added = Add(filepath, width, height, pixels);
+    stbi_image_free(pixels);
+
+    return added;
+}
+
+bool AtlasBuilder::Add(const std::string& key, int width, int height, const unsigned char* pixels)
+{
+    if (width <= 0 || height <= 0)
+        return false;
+
+    Image image;
+    image.Key = key;
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.assign(pixels, pixels + (size_t)width * height * 4);
+
+    m_Images.push_back(std::move(image));
+
+    return true;
+}
+
+bool AtlasBuilder::Build()
+{
+    bool allPacked = true;
+
+    std::vector<stbrp_rect> pending;
+    for (unsigned int i = 0; i < m_Images.size(); i++)
+    {
+        const Image& image = m_Images[i];
+        int width = image.Width + 2 * m_Padding;
+        int height = image.Height + 2 * m_Padding;
+
+        if (width > m_PageSize || height > m_PageSize)
+        {
+            std::cout << "[AtlasBuilder] " << image.Key << " (" << image.Width << "x" << image.Height
+                      << ") is larger than a " << m_PageSize << " page" << std::endl;
+            allPacked = false;
+            continue;
+        }
+
+        stbrp_rect rect = {};
+        rect.id = (int)i;
+        rect.w = (stbrp_coord)width;
+        rect.h = (stbrp_coord)height;
+        pending.push_back(rect);
+    }
+
+    std::vector<stbrp_node> nodes(m_PageSize);
+
+    // Whatever a page has no room for starts the next one
+    while (!pending.empty())
+    {
+        stbrp_context context;
+        stbrp_init_target(&context, m_PageSize, m_PageSize, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, pending.data(), (int)pending.size());
+
+        auto unpacked = std::stable_partition(pending.begin(), pending.end(),
+                                              [](const stbrp_rect& rect) { return rect.was_packed != 0; });
+
+        int pageWidth = 1, pageHeight = 1;
+        for (auto rect = pending.begin(); rect != unpacked; rect++)
+        {
+            pageWidth = std::max(pageWidth, rect->x + rect->w);
+            pageHeight = std::max(pageHeight, rect->y + rect->h);
+        }
+        pageWidth = nextPowerOfTwo(pageWidth);
+        pageHeight = nextPowerOfTwo(pageHeight);
+
+        std::vector<unsigned char> page((size_t)pageWidth * pageHeight * 4, 0);
+        unsigned int pageIndex = (unsigned int)m_Pages.size();
+
+        for (auto rect = pending.begin(); rect != unpacked; rect++)
+        {
+            const Image& image = m_Images[rect->id];
+            int x = rect->x + m_Padding;
+            int y = rect->y + m_Padding;
+
+            blitExtruded(page, pageWidth, image.Pixels.data(), image.Width, image.Height, x, y, m_Padding);
+
+            Region region;
+            region.Page = pageIndex;
+            region.UVMin = glm::vec2((float)x / pageWidth, (float)y / pageHeight);
+            region.UVMax = glm::vec2((float)(x + image.Width) / pageWidth, (float)(y + image.Height) / pageHeight);
+            region.Width = image.Width;
+            region.Height = image.Height;
+            m_Regions[image.Key] = region;
+        }
+
+        m_Pages.push_back(std::make_unique<Texture>(pageWidth, pageHeight, page.data()));
+
+        pending.erase(pending.begin(), unpacked);
+    }
+
+    m_Images.clear();
+
+    return allPacked;
+}
+
+const AtlasBuilder::Region* AtlasBuilder::Find(const std::string& key) const
+{
+    auto it = m_Regions.find(key);
+    return it != m_Regions.end() ? &it->second : nullptr;
+}
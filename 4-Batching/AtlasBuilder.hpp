@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Texture.hpp"
+
+#include "vendor/glm/glm.hpp"
+
+/*
+ Packs many small images into a few large RGBA pages, so sprites that
+ used to be a texture each share one binding and one batch.
+
+ Add() images by file path (or any key with raw pixels), then Build()
+ packs them with stb_rect_pack and uploads the pages. Every image gets
+ `padding` pixels of its own edge repeated around it: linear filtering
+ at a sub-rectangle's border then blends with copies of itself instead
+ of its neighbour. Pages are trimmed to the power of two that holds
+ what was packed into them.
+
+ Find() returns the page and the UV rectangle of an image. Rows are
+ bottom-up like Texture(path), so UVMin is the bottom left corner.
+ */
+class AtlasBuilder
+{
+public:
+    struct Region
+    {
+        unsigned int Page = 0;
+        glm::vec2 UVMin = glm::vec2(0.0f);
+        glm::vec2 UVMax = glm::vec2(1.0f);
+        int Width = 0, Height = 0;
+    };
+
+private:
+    struct Image
+    {
+        std::string Key;
+        int Width, Height;
+        std::vector<unsigned char> Pixels;
+    };
+
+    int m_PageSize;
+    int m_Padding;
+
+    std::vector<Image> m_Images;  // Added since the last Build()
+    std::vector<std::unique_ptr<Texture>> m_Pages;
+    std::unordered_map<std::string, Region> m_Regions;
+
+public:
+    AtlasBuilder(int pageSize = 2048, int padding = 2);
+
+    // Loads `filepath` and keys it by the same path, false if it cannot be read
+    bool Add(const std::string& filepath);
+    // `width` x `height` RGBA8 pixels, rows bottom-up
+    bool Add(const std::string& key, int width, int height, const unsigned char* pixels);
+
+    // Packs and uploads everything added, false if an image did not fit a page
+    bool Build();
+
+    // nullptr for keys that were never added or did not fit
+    const Region* Find(const std::string& key) const;
+
+    inline const Texture& GetPage(unsigned int page) const { return *m_Pages[page]; }
+    inline unsigned int GetPageCount() const { return (unsigned int)m_Pages.size(); }
+    inline unsigned int GetRegionCount() const { return (unsigned int)m_Regions.size(); }
+};
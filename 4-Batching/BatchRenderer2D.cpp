@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <string>
+#include <cstring>
+
+#include "BatchRenderer2D.hpp"
+#include "VertexBufferLayout.hpp"
+#include "Profiler.hpp"
+
+static unsigned int QueryTextureSlotCount()
+{
+    int units = 0;
+    GLCall(glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units));
+    
+    return std::min((unsigned int)std::max(units, 1), BatchRenderer2D::MaxTextureSlots);
+}
+
+// GLSL 3.30 only allows constant indices into sampler arrays, so the lookup
+// is spelled out as one switch case per slot
+static std::string BuildSampleCases(unsigned int slotCount)
+{
+    std::string cases;
+    for (unsigned int i = 0; i < slotCount; i++)
+    {
+        std::string slot = std::to_string(i);
+        cases += "case " + slot + ": return textureGrad(u_Textures[" + slot + "], uv, dx, dy); ";
+    }
+    
+    return cases;
+}
+
+static std::vector<unsigned int> BuildQuadIndices(unsigned int maxQuads)
+{
+    std::vector<unsigned int> indices(maxQuads * 6);
+
+    for (unsigned int i = 0, offset = 0; i < indices.size(); i += 6, offset += 4)
+    {
+        indices[i + 0] = offset + 0;
+        indices[i + 1] = offset + 1;
+        indices[i + 2] = offset + 2;
+
+        indices[i + 3] = offset + 2;
+        indices[i + 4] = offset + 3;
+        indices[i + 5] = offset + 0;
+    }
+
+    return indices;
+}
+
+BatchRenderer2D::BatchRenderer2D(Renderer& renderer, unsigned int maxQuads,
+                                 const std::string& shaderPath)
+:   m_Renderer(renderer),
+    m_MaxQuads(maxQuads),
+    m_Jobs(nullptr),
+    m_TextureSlotCount(QueryTextureSlotCount()),
+    m_TextureSlotIndex(1),
+    // Two full batches per region, three regions in flight
+    m_VertexBuffer(GL_ARRAY_BUFFER, 2 * maxQuads * 4 * sizeof(QuadVertex)),
+    m_IndexBuffer(BuildQuadIndices(maxQuads).data(), maxQuads * 6),
+    m_Shader(shaderPath, {
+        "MAX_TEXTURE_SLOTS " + std::to_string(m_TextureSlotCount),
+        "SAMPLE_TEXTURE_SLOTS " + BuildSampleCases(m_TextureSlotCount)
+    }),
+    m_CameraVersion(0),
+    m_WhiteTexture(1, 1, (const unsigned char*)"\xff\xff\xff\xff")
+{
+    m_Vertices.reserve(maxQuads * 4);
+    m_QuadSlots.reserve(maxQuads);
+
+    VertexBufferLayout layout;
+    layout.Push<float>(3); // Position
+    layout.Push<float>(2); // TexCoord
+    layout.Push<float>(4); // Color
+    layout.Push<float>(1); // TexIndex
+
+    m_VertexArray.AddBuffer(m_VertexBuffer, layout);
+    m_VertexArray.Unbind();
+
+    int samplers[MaxTextureSlots];
+    for (unsigned int i = 0; i < MaxTextureSlots; i++)
+        samplers[i] = i;
+    
+    m_Shader.Bind();
+    m_Shader.SetUniform1iv("u_Textures", m_TextureSlotCount, samplers);
+    m_ViewProjectionUniform = m_Shader.GetUniformHandle("u_ViewProjection"_uniform);
+    
+    m_TextureSlots[0] = &m_WhiteTexture;
+}
+
+void BatchRenderer2D::Begin(const glm::mat4& viewProjection)
+{
+    m_Renderer.BindShader(m_Shader);
+    m_Shader.SetUniformMat4f(m_ViewProjectionUniform, viewProjection);
+    m_CameraVersion = 0;
+
+    m_Vertices.clear();
+    m_TextureSlotIndex = 1;
+}
+
+void BatchRenderer2D::Begin(const Camera& camera)
+{
+    m_Renderer.BindShader(m_Shader);
+    if (camera.GetVersion() != m_CameraVersion)
+    {
+        m_Shader.SetUniformMat4f(m_ViewProjectionUniform, camera.GetViewProjection());
+        m_CameraVersion = camera.GetVersion();
+    }
+
+    m_Vertices.clear();
+    m_TextureSlotIndex = 1;
+}
+
+void BatchRenderer2D::End()
+{
+    Flush();
+}
+
+void BatchRenderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color)
+{
+    PushQuad(position, size, color, 0.0f);
+}
+
+void BatchRenderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size,
+                               const Texture& texture, const glm::vec4& tint)
+{
+    PushQuad(position, size, tint, GetTextureSlot(texture));
+}
+
+void BatchRenderer2D::DrawQuad(const glm::vec3& position, const glm::vec2& size, const Texture& texture,
+                               const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint)
+{
+    PushQuad(position, size, tint, GetTextureSlot(texture), uvMin, uvMax);
+}
+
+void BatchRenderer2D::DrawQuad(const glm::mat4& transform, const glm::vec4& color)
+{
+    PushQuad(transform, color, 0.0f);
+}
+
+void BatchRenderer2D::DrawQuad(const glm::mat4& transform, const Texture& texture,
+                               const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint)
+{
+    PushQuad(transform, tint, GetTextureSlot(texture), uvMin, uvMax);
+}
+
+float BatchRenderer2D::GetTextureSlot(const Texture& texture)
+{
+    float slot = FindTextureSlot(texture);
+    if (slot >= 0.0f)
+        return slot;
+
+    // Every slot is taken by another texture, start a new batch
+    Flush();
+    return FindTextureSlot(texture);
+}
+
+float BatchRenderer2D::FindTextureSlot(const Texture& texture)
+{
+    for (unsigned int i = 1; i < m_TextureSlotIndex; i++)
+    {
+        if (m_TextureSlots[i] == &texture)
+            return (float)i;
+    }
+
+    if (m_TextureSlotIndex == m_TextureSlotCount)
+        return -1.0f;
+
+    m_TextureSlots[m_TextureSlotIndex] = &texture;
+    return (float)m_TextureSlotIndex++;
+}
+
+void BatchRenderer2D::PushQuad(const glm::vec3& position, const glm::vec2& size,
+                               const glm::vec4& color, float texIndex,
+                               const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+    ReserveQuad();
+
+    m_Vertices.resize(m_Vertices.size() + 4);
+    WriteQuad(&m_Vertices[m_Vertices.size() - 4], position, size, color, texIndex, uvMin, uvMax);
+}
+
+void BatchRenderer2D::PushQuad(const glm::mat4& transform, const glm::vec4& color, float texIndex,
+                               const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+    ReserveQuad();
+
+    m_Vertices.resize(m_Vertices.size() + 4);
+    WriteQuad(&m_Vertices[m_Vertices.size() - 4], transform, color, texIndex, uvMin, uvMax);
+}
+
+void BatchRenderer2D::WriteQuad(QuadVertex* vertices, const glm::vec3& position, const glm::vec2& size,
+                                const glm::vec4& color, float texIndex,
+                                const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+    const glm::vec2 half = size * 0.5f;
+
+    vertices[0] = { { position.x - half.x, position.y - half.y, position.z }, { uvMin.x, uvMin.y }, color, texIndex };
+    vertices[1] = { { position.x + half.x, position.y - half.y, position.z }, { uvMax.x, uvMin.y }, color, texIndex };
+    vertices[2] = { { position.x + half.x, position.y + half.y, position.z }, { uvMax.x, uvMax.y }, color, texIndex };
+    vertices[3] = { { position.x - half.x, position.y + half.y, position.z }, { uvMin.x, uvMax.y }, color, texIndex };
+}
+
+void BatchRenderer2D::WriteQuad(QuadVertex* vertices, const glm::mat4& transform, const glm::vec4& color, float texIndex,
+                                const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+    // Corners of the unit quad are the center plus or minus half of each axis
+    const glm::vec3 center(transform[3]);
+    const glm::vec3 x(transform[0] * 0.5f);
+    const glm::vec3 y(transform[1] * 0.5f);
+
+    vertices[0] = { center - x - y, { uvMin.x, uvMin.y }, color, texIndex };
+    vertices[1] = { center + x - y, { uvMax.x, uvMin.y }, color, texIndex };
+    vertices[2] = { center + x + y, { uvMax.x, uvMax.y }, color, texIndex };
+    vertices[3] = { center - x + y, { uvMin.x, uvMax.y }, color, texIndex };
+}
+
+void BatchRenderer2D::ReserveQuad()
+{
+    if (m_Vertices.size() < m_MaxQuads * 4)
+        return;
+
+    // Slots stay bound, the quads assigned to them are still pending
+    unsigned int slots = m_TextureSlotIndex;
+    Flush();
+    m_TextureSlotIndex = slots;
+}
+
+void BatchRenderer2D::Flush()
+{
+    if (m_Vertices.empty())
+    {
+        // Nothing drawn with them, the slots are free again
+        m_TextureSlotIndex = 1;
+        return;
+    }
+
+    unsigned int quadCount = (unsigned int)m_Vertices.size() / 4;
+    MapBatch(0);
+    DrawBatch(quadCount);
+}
+
+QuadVertex* BatchRenderer2D::MapBatch(unsigned int extraQuads)
+{
+    unsigned int pendingSize = (unsigned int)(m_Vertices.size() * sizeof(QuadVertex));
+    unsigned int size = pendingSize + extraQuads * 4 * sizeof(QuadVertex);
+
+    QuadVertex* destination = (QuadVertex*)m_VertexBuffer.Map(size, sizeof(QuadVertex));
+    memcpy(destination, m_Vertices.data(), pendingSize);
+
+    QuadVertex* extra = destination + m_Vertices.size();
+    m_Vertices.clear();
+    return extra;
+}
+
+void BatchRenderer2D::DrawBatch(unsigned int quadCount)
+{
+    PROFILE_ZONE("Batch flush");
+
+    unsigned int baseVertex = m_VertexBuffer.Unmap() / sizeof(QuadVertex);
+
+    for (unsigned int i = 0; i < m_TextureSlotIndex; i++)
+        m_Renderer.BindTexture(*m_TextureSlots[i], i);
+
+    m_Renderer.Draw(m_VertexArray, m_IndexBuffer, m_Shader, quadCount * 6, baseVertex);
+
+    m_Stats.DrawCalls++;
+    m_Stats.QuadCount += quadCount;
+    m_Stats.BytesUploaded += quadCount * 4 * sizeof(QuadVertex);
+
+    m_TextureSlotIndex = 1;
+}
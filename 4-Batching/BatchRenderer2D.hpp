@@ -0,0 +1,201 @@
+#pragma once
+
+#include <vector>
+
+#include "Renderer.h"
+#include "StreamingBuffer.hpp"
+#include "IndexBuffer.hpp"
+#include "VertexArray.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "Camera.hpp"
+#include "JobSystem.hpp"
+
+#include "vendor/glm/glm.hpp"
+
+struct QuadVertex
+{
+    glm::vec3 Position;
+    glm::vec2 TexCoord;
+    glm::vec4 Color;
+    float     TexIndex;
+};
+
+/*
+ Collects quads into one CPU vertex array and streams each batch into a
+ StreamingBuffer ring, drawn with a base vertex. The index pattern (0 1 2 2 3 0 + 4 * i) never
+ changes, so it is built once for the whole capacity.
+ 
+ Textures are packed into the slots of a sampler array (u_Textures),
+ sized from GL_MAX_TEXTURE_IMAGE_UNITS. Slot 0 is a 1x1 white texture
+ for flat colored quads. A batch is flushed only when it is full, when
+ every slot is taken by another texture or on End().
+
+ DrawQuads() takes many quads at once. Their texture slots are worked
+ out on the calling thread, in order, which also decides where each
+ batch ends. The vertices are then written on the JobSystem, when one
+ is set, every job its own range of quads: straight into the mapped
+ StreamingBuffer for a batch that is full, into the CPU array for the
+ last one so later quads can still join it. Quad i always lands at the
+ same place, however many threads there are, and GL is only ever called
+ from the thread drawing.
+ */
+class BatchRenderer2D
+{
+public:
+    // Upper bound of the shader's sampler array, whatever the driver reports
+    static const unsigned int MaxTextureSlots = 32;
+    
+
+    struct Stats
+    {
+        unsigned int DrawCalls = 0;
+        unsigned int QuadCount = 0;
+        unsigned int BytesUploaded = 0;
+    };
+
+private:
+    Renderer& m_Renderer;
+
+    unsigned int m_MaxQuads;
+    std::vector<QuadVertex> m_Vertices;
+    std::vector<float> m_QuadSlots;     // DrawQuads() texture slot per quad of the batch being filled
+    JobSystem* m_Jobs;
+
+    unsigned int m_TextureSlotCount;
+    const Texture* m_TextureSlots[MaxTextureSlots];
+    unsigned int m_TextureSlotIndex;
+
+    VertexArray  m_VertexArray;
+    StreamingBuffer m_VertexBuffer;
+    IndexBuffer  m_IndexBuffer;
+    Shader       m_Shader;
+    UniformHandle m_ViewProjectionUniform;
+    uint64_t     m_CameraVersion;   // Camera state in u_ViewProjection, 0 after a plain matrix
+    Texture      m_WhiteTexture;
+
+    Stats m_Stats;
+
+public:
+    BatchRenderer2D(Renderer& renderer, unsigned int maxQuads = 20000,
+                    const std::string& shaderPath = "Shaders/Batch.shader");
+
+    // Null to write DrawQuads() vertices on the calling thread only
+    inline void SetJobSystem(JobSystem* jobs) { m_Jobs = jobs; }
+
+    void Begin(const glm::mat4& viewProjection);
+    // Uploads the view-projection only when the camera changed since the last Begin()
+    void Begin(const Camera& camera);
+    void End();
+
+    void DrawQuad(const glm::vec3& position, const glm::vec2& size, const glm::vec4& color);
+    void DrawQuad(const glm::vec3& position, const glm::vec2& size,
+                  const Texture& texture, const glm::vec4& tint = glm::vec4(1.0f));
+    // Part of `texture` between `uvMin` and `uvMax`, e.g. an AtlasBuilder region
+    void DrawQuad(const glm::vec3& position, const glm::vec2& size, const Texture& texture,
+                  const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint = glm::vec4(1.0f));
+    // Unit quad centered on the origin, moved, rotated and sized by `transform`
+    void DrawQuad(const glm::mat4& transform, const glm::vec4& color);
+    void DrawQuad(const glm::mat4& transform, const Texture& texture,
+                  const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint = glm::vec4(1.0f));
+    /*
+     `count` quads in one go, drawn as if by that many DrawQuad() calls.
+     getTexture(i) returns quad i's texture, null for a flat colored one,
+     and is called in order on this thread. expand(i, texIndex, vertices)
+     writes quad i's four vertices, e.g. with WriteQuad(), and may run on
+     any thread at the same time as other quads.
+     */
+    template<typename GetTexture, typename Expand>
+    void DrawQuads(uint32_t count, const GetTexture& getTexture, const Expand& expand);
+
+    // The four vertices DrawQuad() would add, for DrawQuads()
+    static void WriteQuad(QuadVertex* vertices, const glm::vec3& position, const glm::vec2& size,
+                          const glm::vec4& color, float texIndex,
+                          const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+    static void WriteQuad(QuadVertex* vertices, const glm::mat4& transform, const glm::vec4& color, float texIndex,
+                          const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+
+    void Flush();
+
+    inline unsigned int GetTextureSlotCount() const { return m_TextureSlotCount; }
+    inline const Stats& GetStats() const { return m_Stats; }
+    inline void ResetStats() { m_Stats = Stats(); }
+
+private:
+    // Quads per DrawQuads() job
+    static const uint32_t ExpandGrain = 2048;
+
+    float GetTextureSlot(const Texture& texture);
+    // -1 when every slot is taken by another texture
+    float FindTextureSlot(const Texture& texture);
+    void PushQuad(const glm::vec3& position, const glm::vec2& size,
+                  const glm::vec4& color, float texIndex,
+                  const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+    void PushQuad(const glm::mat4& transform, const glm::vec4& color, float texIndex,
+                  const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+    // Flushes a full batch before the next quad
+    void ReserveQuad();
+    // Maps the pending quads and `extraQuads` more, copies the pending ones and returns the rest
+    QuadVertex* MapBatch(unsigned int extraQuads);
+    // Unmaps what MapBatch() returned and draws `quadCount` quads
+    void DrawBatch(unsigned int quadCount);
+};
+
+template<typename GetTexture, typename Expand>
+void BatchRenderer2D::DrawQuads(uint32_t count, const GetTexture& getTexture, const Expand& expand)
+{
+    uint32_t begin = 0;
+    while (begin < count)
+    {
+        uint32_t pending = (uint32_t)m_Vertices.size() / 4;
+
+        // Slots in order, up to a full batch or the first texture that does not fit
+        m_QuadSlots.clear();
+        uint32_t end = begin;
+        while (end < count && pending + (end - begin) < m_MaxQuads)
+        {
+            const Texture* texture = getTexture(end);
+            float slot = texture ? FindTextureSlot(*texture) : 0.0f;
+            if (slot < 0.0f)
+                break;
+
+            m_QuadSlots.push_back(slot);
+            end++;
+        }
+
+        if (end == begin)
+        {
+            Flush();
+            continue;
+        }
+
+        uint32_t quadCount = end - begin;
+        bool full = end < count;
+        QuadVertex* vertices;
+        if (full)
+        {
+            vertices = MapBatch(quadCount);
+        }
+        else
+        {
+            m_Vertices.resize(m_Vertices.size() + quadCount * 4);
+            vertices = &m_Vertices[pending * 4];
+        }
+
+        auto write = [this, begin, vertices, &expand](uint32_t first, uint32_t last)
+        {
+            for (uint32_t i = first; i < last; i++)
+                expand(begin + i, m_QuadSlots[i], vertices + i * 4);
+        };
+
+        if (m_Jobs)
+            m_Jobs->ParallelFor(0, quadCount, ExpandGrain, write);
+        else
+            write(0, quadCount);
+
+        if (full)
+            DrawBatch(pending + quadCount);
+
+        begin = end;
+    }
+}
@@ -0,0 +1,591 @@
+/*
+ Renders scripted scenarios into an offscreen framebuffer for a fixed
+ number of frames and writes ms/frame percentiles, draw calls, state
+ changes and bytes uploaded per frame as JSON. No window and no GPU
+ needed: on a build server Mesa's llvmpipe does the rendering.
+
+ Scenarios (--scenarios, comma separated, all by default):
+   quads     --quads flat colored quads through BatchRenderer2D
+   textures  --quads quads spread over --textures textures
+   shaders   --switches draws, each with a different program than the last
+             (--shaders programs from Shaders/Basic.shader)
+   imgui     the ImGui demo window
+   entities  --entities sprites in an EntityStore, flat colored parents
+             with a textured child each, 1% of the parents moving every frame
+   sprites   --sprites quads sorted by --textures textures through
+             BatchRenderer2D::DrawQuads(), only run when listed
+
+ The entities and sprites scenarios write their vertices on a JobSystem
+ of --threads threads (the machine's by default, 1 for none).
+
+ Every frame is cleared, drawn and glFinish()ed, so ms/frame covers the
+ GPU (or llvmpipe) work and not just submission. --warmup frames run
+ first and are not counted.
+
+ --capture <prefix> also writes the last frame of every scenario to
+ <prefix><scenario>.png, e.g. to diff against golden images.
+
+ Build and run on Linux from 4-Batching, shaders are loaded relative to it:
+   gcc -O2 -I../Dependencies/Include -c ../Dependencies/glad.c -o glad.o
+   g++ -std=gnu++17 -O2 -I../Dependencies/Include \
+       Benchmark/HeadlessBenchmark.cpp Benchmark/HeadlessContext.cpp \
+       BatchRenderer2D.cpp BufferUsage.cpp EntityStore.cpp IndexBuffer.cpp JobSystem.cpp Profiler.cpp Renderer.cpp Shader.cpp ShaderParser.cpp \
+       ShaderWatcher.cpp SpatialGrid.cpp StreamingBuffer.cpp Texture.cpp TextureFile.cpp VertexArray.cpp VertexBuffer.cpp VertexBufferLayout.cpp \
+       FrameCapture.cpp ImageWriter.cpp vendor/stb_image.cpp vendor/imgui/imgui.cpp vendor/imgui/imgui_draw.cpp \
+       vendor/imgui/imgui_tables.cpp vendor/imgui/imgui_widgets.cpp \
+       vendor/imgui/imgui_impl_opengl3.cpp ../imgui_demo.cpp glad.o \
+       -lEGL -ldl -lpthread -o headless-benchmark
+   ./headless-benchmark --frames 300 --output benchmark.json
+ Add -DHEADLESS_OSMESA and link -lOSMesa instead of -lEGL for OSMesa.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HeadlessContext.hpp"
+
+#include "../Renderer.h"
+#include "../BatchRenderer2D.hpp"
+#include "../VertexBuffer.h"
+#include "../IndexBuffer.hpp"
+#include "../VertexBufferLayout.hpp"
+#include "../VertexArray.hpp"
+#include "../Shader.hpp"
+#include "../Texture.hpp"
+#include "../FrameCapture.hpp"
+#include "../EntityStore.hpp"
+#include "../JobSystem.hpp"
+
+#include "../vendor/glm/gtc/matrix_transform.hpp"
+#include "../vendor/imgui/imgui.h"
+#include "../vendor/imgui/imgui_impl_opengl3.h"
+
+struct Options
+{
+    int Frames = 300;
+    int Warmup = 30;
+    int Width = 1280;
+    int Height = 720;
+    int Quads = 20000;
+    int Textures = 64;
+    int Shaders = 16;
+    int Switches = 2000;
+    int Entities = 20000;
+    int Sprites = 500000;
+    int Threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::string> Scenarios = { "quads", "textures", "shaders", "imgui", "entities" };
+    std::string Output = "benchmark.json";
+    std::string Capture;
+};
+
+// What one frame did, filled in by the scenario
+struct FrameCounters
+{
+    unsigned int DrawCalls = 0;
+    unsigned int StateChanges = 0;
+    unsigned int BytesUploaded = 0;
+};
+
+struct ScenarioResult
+{
+    std::string Name;
+    int Count;
+    std::vector<double> FrameMs;
+    double DrawCalls = 0.0;
+    double StateChanges = 0.0;
+    double BytesUploaded = 0.0;
+    bool TracksStateChanges = true;
+};
+
+// Set when --capture is given
+static FrameCapture* s_Capture = nullptr;
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--help" || i + 1 >= argc)
+            return false;
+
+        const char* value = argv[++i];
+
+        if      (flag == "--frames")    options.Frames = atoi(value);
+        else if (flag == "--warmup")    options.Warmup = atoi(value);
+        else if (flag == "--width")     options.Width = atoi(value);
+        else if (flag == "--height")    options.Height = atoi(value);
+        else if (flag == "--quads")     options.Quads = atoi(value);
+        else if (flag == "--textures")  options.Textures = atoi(value);
+        else if (flag == "--shaders")   options.Shaders = atoi(value);
+        else if (flag == "--switches")  options.Switches = atoi(value);
+        else if (flag == "--entities")  options.Entities = atoi(value);
+        else if (flag == "--sprites")   options.Sprites = atoi(value);
+        else if (flag == "--threads")   options.Threads = atoi(value);
+        else if (flag == "--output")    options.Output = value;
+        else if (flag == "--capture")   options.Capture = value;
+        else if (flag == "--scenarios")
+        {
+            options.Scenarios.clear();
+            std::stringstream list(value);
+            std::string name;
+            while (std::getline(list, name, ','))
+                options.Scenarios.push_back(name);
+        }
+        else
+            return false;
+    }
+
+    return options.Frames > 0 && options.Width > 0 && options.Height > 0 &&
+           options.Textures > 0 && options.Shaders > 0 && options.Threads > 0;
+}
+
+static std::vector<std::unique_ptr<Texture>> createTextures(int count)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> channel(64, 255);
+
+    std::vector<std::unique_ptr<Texture>> textures;
+    for (int i = 0; i < count; i++)
+    {
+        unsigned char pixels[8 * 8 * 4];
+        for (int p = 0; p < 8 * 8; p++)
+        {
+            pixels[p * 4 + 0] = channel(rng);
+            pixels[p * 4 + 1] = channel(rng);
+            pixels[p * 4 + 2] = channel(rng);
+            pixels[p * 4 + 3] = 255;
+        }
+
+        textures.push_back(std::make_unique<Texture>(8, 8, pixels));
+    }
+
+    return textures;
+}
+
+static ScenarioResult runScenario(const std::string& name, int count, const Options& options,
+                                  const HeadlessContext& context, Renderer& renderer,
+                                  const std::function<void(FrameCounters&)>& drawFrame)
+{
+    ScenarioResult result;
+    result.Name = name;
+    result.Count = count;
+
+    for (int frame = 0; frame < options.Warmup + options.Frames; frame++)
+    {
+        // Scenarios like ImGui bind behind the renderer's back
+        context.Bind();
+        renderer.InvalidateState();
+        renderer.ResetStats();
+
+        FrameCounters counters;
+
+        auto start = std::chrono::steady_clock::now();
+        renderer.Clear();
+        drawFrame(counters);
+        GLCall(glFinish());
+        auto end = std::chrono::steady_clock::now();
+
+        if (frame < options.Warmup)
+            continue;
+
+        result.FrameMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        result.DrawCalls += counters.DrawCalls;
+        result.StateChanges += counters.StateChanges;
+        result.BytesUploaded += counters.BytesUploaded;
+    }
+
+    // Outside the timed frames, the readback itself would skew the last one
+    if (s_Capture)
+        s_Capture->Capture(options.Capture + name + ".png", FrameCapture::Format::PNG,
+                           context.GetWidth(), context.GetHeight(), context.GetFramebuffer());
+
+    result.DrawCalls /= options.Frames;
+    result.StateChanges /= options.Frames;
+    result.BytesUploaded /= options.Frames;
+
+    return result;
+}
+
+static ScenarioResult runBatchScenario(const std::string& name, int count, int textureCount,
+                                       const Options& options, const HeadlessContext& context,
+                                       Renderer& renderer)
+{
+    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
+
+    BatchRenderer2D batch(renderer);
+    std::vector<std::unique_ptr<Texture>> textures = createTextures(textureCount);
+
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    std::vector<glm::vec3> positions(options.Quads);
+    for (glm::vec3& p : positions)
+        p = { position(rng), position(rng), 0.0f };
+
+    return runScenario(name, count, options, context, renderer, [&](FrameCounters& counters)
+    {
+        batch.ResetStats();
+        batch.Begin(proj);
+
+        for (int i = 0; i < options.Quads; i++)
+        {
+            if (textures.empty())
+                batch.DrawQuad(positions[i], glm::vec2(1.0f), glm::vec4(0.4f, 0.8f, 0.9f, 1.0f));
+            else
+                batch.DrawQuad(positions[i], glm::vec2(1.0f), *textures[i % textures.size()]);
+        }
+
+        batch.End();
+
+        counters.DrawCalls = renderer.GetStats().DrawCalls;
+        counters.StateChanges = renderer.GetStats().StateChanges;
+        counters.BytesUploaded = batch.GetStats().BytesUploaded;
+    });
+}
+
+static ScenarioResult runEntityScenario(const Options& options, const HeadlessContext& context,
+                                        Renderer& renderer, JobSystem* jobs)
+{
+    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
+
+    BatchRenderer2D batch(renderer);
+    batch.SetJobSystem(jobs);
+    std::vector<std::unique_ptr<Texture>> textures = createTextures(1);
+
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+
+    EntityStore entities;
+    std::vector<Entity> parents;
+    for (int i = 0; i + 1 < options.Entities; i += 2)
+    {
+        Entity parent = entities.Create();
+        entities.AddTransform(parent, { glm::vec3(position(rng), position(rng), 0.0f) });
+        entities.AddSprite(parent, { glm::vec2(1.0f) });
+        entities.AddColor(parent, { glm::vec4(0.4f, 0.8f, 0.9f, 1.0f) });
+
+        Entity child = entities.Create();
+        entities.SetParent(child, parent);
+        entities.SetTransform(child, { glm::vec3(0.5f, 0.5f, 0.0f), 0.3f, glm::vec2(0.5f) });
+        entities.AddSprite(child, { glm::vec2(1.0f), textures[0].get() });
+
+        parents.push_back(parent);
+    }
+
+    int frame = 0;
+    return runScenario("entities", options.Entities, options, context, renderer, [&](FrameCounters& counters)
+    {
+        // A different 1% every frame, their children follow through propagation
+        size_t moving = std::max<size_t>(parents.size() / 100, 1);
+        for (size_t i = 0; i < moving && !parents.empty(); i++)
+        {
+            Entity parent = parents[(frame * moving + i) % parents.size()];
+            entities.SetPosition(parent, glm::vec3(position(rng), position(rng), 0.0f));
+        }
+        frame++;
+
+        batch.ResetStats();
+        batch.Begin(proj);
+
+        entities.UpdateTransforms();
+        entities.DrawSprites(batch);
+
+        batch.End();
+
+        counters.DrawCalls = renderer.GetStats().DrawCalls;
+        counters.StateChanges = renderer.GetStats().StateChanges;
+        counters.BytesUploaded = batch.GetStats().BytesUploaded;
+    });
+}
+
+static ScenarioResult runSpriteScenario(const Options& options, const HeadlessContext& context,
+                                        Renderer& renderer, JobSystem* jobs)
+{
+    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
+
+    BatchRenderer2D batch(renderer);
+    batch.SetJobSystem(jobs);
+    std::vector<std::unique_ptr<Texture>> textures = createTextures(options.Textures);
+
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    std::vector<glm::vec3> positions(options.Sprites);
+    for (glm::vec3& p : positions)
+        p = { position(rng), position(rng), 0.0f };
+
+    return runScenario("sprites", options.Sprites, options, context, renderer, [&](FrameCounters& counters)
+    {
+        batch.ResetStats();
+        batch.Begin(proj);
+
+        batch.DrawQuads((uint32_t)positions.size(),
+            // Sorted by texture, as a game would submit them
+            [&](uint32_t i) { return textures[(size_t)i * textures.size() / positions.size()].get(); },
+            [&](uint32_t i, float texIndex, QuadVertex* vertices)
+            {
+                BatchRenderer2D::WriteQuad(vertices, positions[i], glm::vec2(0.25f), glm::vec4(1.0f), texIndex);
+            });
+
+        batch.End();
+
+        counters.DrawCalls = renderer.GetStats().DrawCalls;
+        counters.StateChanges = renderer.GetStats().StateChanges;
+        counters.BytesUploaded = batch.GetStats().BytesUploaded;
+    });
+}
+
+static ScenarioResult runShaderScenario(const Options& options, const HeadlessContext& context,
+                                        Renderer& renderer)
+{
+    float quadVertices[] = {
+        -0.5f, -0.5f, 0.0f, 0.0f,
+         0.5f, -0.5f, 1.0f, 0.0f,
+         0.5f,  0.5f, 1.0f, 1.0f,
+        -0.5f,  0.5f, 0.0f, 1.0f,
+    };
+    unsigned int quadIndices[] = { 0, 1, 2, 2, 3, 0 };
+
+    VertexArray va;
+    VertexBuffer vb(quadVertices, sizeof(quadVertices));
+    IndexBuffer ib(quadIndices, 6);
+
+    VertexBufferLayout layout;
+    layout.Push<float>(2);
+    layout.Push<float>(2);
+    va.AddBuffer(vb, layout);
+    va.Unbind();
+
+    // The define only makes every program a separate link, the code is the same
+    std::vector<std::unique_ptr<Shader>> shaders;
+    for (int i = 0; i < options.Shaders; i++)
+        shaders.push_back(std::make_unique<Shader>("Shaders/Basic.shader", std::vector<std::string>{ "VARIANT_" + std::to_string(i) }));
+
+    // Looked up once, so the frames only time the program switches
+    std::vector<UniformHandle> mvpUniforms, colorUniforms;
+    for (const std::unique_ptr<Shader>& shader : shaders)
+    {
+        mvpUniforms.push_back(shader->GetUniformHandle("u_MVP"_uniform));
+        colorUniforms.push_back(shader->GetUniformHandle("u_Color"_uniform));
+    }
+
+    std::vector<std::unique_ptr<Texture>> textures = createTextures(1);
+
+    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
+    std::vector<glm::mat4> mvps(options.Switches);
+    for (int i = 0; i < options.Switches; i++)
+        mvps[i] = glm::translate(proj, glm::vec3((i % 100) + 0.5f, (i / 100 % 100) + 0.5f, 0.0f));
+
+    return runScenario("shaders", options.Switches, options, context, renderer, [&](FrameCounters& counters)
+    {
+        renderer.BindTexture(*textures[0], 0);
+
+        for (int i = 0; i < options.Switches; i++)
+        {
+            size_t index = i % shaders.size();
+            const Shader& shader = *shaders[index];
+            renderer.BindShader(shader);
+            shader.SetUniformMat4f(mvpUniforms[index], mvps[i]);
+            shader.SetUniform4f(colorUniforms[index], 0.4f, 0.8f, 0.9f, 1.0f);
+            renderer.Draw(va, ib, shader);
+        }
+
+        counters.DrawCalls = renderer.GetStats().DrawCalls;
+        counters.StateChanges = renderer.GetStats().StateChanges;
+    });
+}
+
+static ScenarioResult runImGuiScenario(const Options& options, const HeadlessContext& context,
+                                       Renderer& renderer)
+{
+    ImGui::CreateContext();
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize = ImVec2((float)options.Width, (float)options.Height);
+    io.IniFilename = nullptr;
+    ImGui::StyleColorsDark();
+    ImGui_ImplOpenGL3_Init("#version 330 core");
+
+    ScenarioResult result = runScenario("imgui", 1, options, context, renderer, [&](FrameCounters& counters)
+    {
+        // Fixed time step, so every run animates the same
+        io.DeltaTime = 1.0f / 60.0f;
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui::NewFrame();
+        ImGui::ShowDemoWindow();
+        ImGui::Render();
+
+        ImDrawData* drawData = ImGui::GetDrawData();
+        ImGui_ImplOpenGL3_RenderDrawData(drawData);
+
+        for (int i = 0; i < drawData->CmdListsCount; i++)
+        {
+            const ImDrawList* list = drawData->CmdLists[i];
+            counters.DrawCalls += list->CmdBuffer.Size;
+            counters.BytesUploaded += list->VtxBuffer.Size * sizeof(ImDrawVert) + list->IdxBuffer.Size * sizeof(ImDrawIdx);
+        }
+    });
+
+    // The ImGui backend binds on its own, nothing to count
+    result.TracksStateChanges = false;
+
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui::DestroyContext();
+
+    return result;
+}
+
+// Nearest rank on sorted samples
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = (size_t)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static void writeResult(std::ostream& stream, const ScenarioResult& result)
+{
+    std::vector<double> sorted = result.FrameMs;
+    std::sort(sorted.begin(), sorted.end());
+
+    double mean = 0.0;
+    for (double ms : sorted)
+        mean += ms;
+    mean /= sorted.size();
+
+    stream << "    {\n"
+           << "      \"name\": \"" << result.Name << "\",\n"
+           << "      \"count\": " << result.Count << ",\n"
+           << "      \"frames\": " << sorted.size() << ",\n"
+           << "      \"ms_per_frame\": { "
+           << "\"mean\": " << mean
+           << ", \"min\": " << sorted.front()
+           << ", \"p50\": " << percentile(sorted, 50.0)
+           << ", \"p90\": " << percentile(sorted, 90.0)
+           << ", \"p99\": " << percentile(sorted, 99.0)
+           << ", \"max\": " << sorted.back() << " },\n"
+           << "      \"draw_calls\": " << result.DrawCalls << ",\n"
+           << "      \"state_changes\": ";
+
+    if (result.TracksStateChanges)
+        stream << result.StateChanges;
+    else
+        stream << "null";
+
+    stream << ",\n"
+           << "      \"bytes_uploaded\": " << result.BytesUploaded << "\n"
+           << "    }";
+}
+
+static std::string jsonEscape(const char* text)
+{
+    std::string escaped;
+    for (const char* c = text ? text : ""; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            escaped += '\\';
+        escaped += *c;
+    }
+
+    return escaped;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "usage: " << argv[0] << " [--frames N] [--warmup N] [--width N] [--height N]"
+                  << " [--quads N] [--textures N] [--shaders N] [--switches N] [--entities N]"
+                  << " [--sprites N] [--threads N]"
+                  << " [--scenarios quads,textures,shaders,imgui,entities,sprites] [--output file.json]"
+                  << " [--capture prefix]" << std::endl;
+        return 2;
+    }
+
+    HeadlessContext context(options.Width, options.Height);
+    if (!context.IsValid())
+        return 1;
+
+    const char* glRenderer = (const char*)glGetString(GL_RENDERER);
+    const char* glVersion = (const char*)glGetString(GL_VERSION);
+    std::cout << "GL: " << glRenderer << ", " << glVersion << std::endl;
+
+    GLCall(glEnable(GL_BLEND));
+    GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+
+    Renderer renderer;
+    std::vector<ScenarioResult> results;
+
+    JobSystem jobs(options.Threads - 1);
+    JobSystem* vertexJobs = options.Threads > 1 ? &jobs : nullptr;
+
+    std::unique_ptr<FrameCapture> capture;
+    if (!options.Capture.empty())
+    {
+        capture = std::make_unique<FrameCapture>();
+        s_Capture = capture.get();
+    }
+
+    for (const std::string& scenario : options.Scenarios)
+    {
+        if (scenario == "quads")
+            results.push_back(runBatchScenario("quads", options.Quads, 0, options, context, renderer));
+        else if (scenario == "textures")
+            results.push_back(runBatchScenario("textures", options.Textures, options.Textures, options, context, renderer));
+        else if (scenario == "shaders")
+            results.push_back(runShaderScenario(options, context, renderer));
+        else if (scenario == "imgui")
+            results.push_back(runImGuiScenario(options, context, renderer));
+        else if (scenario == "entities")
+            results.push_back(runEntityScenario(options, context, renderer, vertexJobs));
+        else if (scenario == "sprites")
+            results.push_back(runSpriteScenario(options, context, renderer, vertexJobs));
+        else
+        {
+            std::cout << "Unknown scenario " << scenario << std::endl;
+            return 2;
+        }
+
+        const ScenarioResult& result = results.back();
+        std::vector<double> sorted = result.FrameMs;
+        std::sort(sorted.begin(), sorted.end());
+        std::cout << result.Name << ": p50 " << percentile(sorted, 50.0) << " ms, p99 "
+                  << percentile(sorted, 99.0) << " ms, " << result.DrawCalls << " draws/frame" << std::endl;
+    }
+
+    if (capture)
+        capture->Finish();
+
+    std::ofstream stream(options.Output);
+    if (!stream)
+    {
+        std::cout << "Could not open " << options.Output << std::endl;
+        return 1;
+    }
+
+    stream << "{\n"
+           << "  \"renderer\": \"" << jsonEscape(glRenderer) << "\",\n"
+           << "  \"version\": \"" << jsonEscape(glVersion) << "\",\n"
+           << "  \"width\": " << options.Width << ",\n"
+           << "  \"height\": " << options.Height << ",\n"
+           << "  \"scenarios\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        writeResult(stream, results[i]);
+        stream << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+
+    stream << "  ]\n}\n";
+
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include <iostream>
+
+#include "HeadlessContext.hpp"
+#include "../Renderer.h"
+
+#ifdef HEADLESS_OSMESA
+    #include <GL/osmesa.h>
+#else
+    // No X11 headers, there is no display server to talk to
+    #define EGL_NO_X11
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+// Newest first, the first one the driver accepts wins
+static const int s_ContextVersions[][2] = { { 4, 5 }, { 4, 1 }, { 3, 3 } };
+
+HeadlessContext::HeadlessContext(int width, int height)
+:   m_Display(nullptr),
+    m_Context(nullptr),
+    m_OSMesaBuffer(nullptr),
+    m_Framebuffer(0),
+    m_ColorBuffer(0),
+    m_DepthBuffer(0),
+    m_Width(width),
+    m_Height(height),
+    m_Valid(false)
+{
+    m_Valid = CreateContext() && CreateFramebuffer();
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    if (m_Framebuffer)
+    {
+        GLCall(glDeleteFramebuffers(1, &m_Framebuffer));
+        GLCall(glDeleteRenderbuffers(1, &m_ColorBuffer));
+        GLCall(glDeleteRenderbuffers(1, &m_DepthBuffer));
+    }
+
+    DestroyContext();
+}
+
+void HeadlessContext::Bind() const
+{
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer));
+    GLCall(glViewport(0, 0, m_Width, m_Height));
+}
+
+#ifdef HEADLESS_OSMESA
+
+bool HeadlessContext::CreateContext()
+{
+    // OSMesa still wants a buffer to make the context current, even though we draw into an FBO
+    m_OSMesaBuffer = new unsigned char[m_Width * m_Height * 4];
+
+    for (const int* version : s_ContextVersions)
+    {
+        const int attributes[] = {
+            OSMESA_FORMAT, OSMESA_RGBA,
+            OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+            OSMESA_CONTEXT_MAJOR_VERSION, version[0],
+            OSMESA_CONTEXT_MINOR_VERSION, version[1],
+            0
+        };
+
+        m_Context = OSMesaCreateContextAttribs(attributes, nullptr);
+        if (m_Context)
+            break;
+    }
+
+    if (!m_Context)
+    {
+        std::cout << "[Headless] OSMesa could not create a core profile context" << std::endl;
+        return false;
+    }
+
+    if (!OSMesaMakeCurrent((OSMesaContext)m_Context, m_OSMesaBuffer, GL_UNSIGNED_BYTE, m_Width, m_Height))
+    {
+        std::cout << "[Headless] OSMesaMakeCurrent failed" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)OSMesaGetProcAddress))
+    {
+        std::cout << "[Headless] glad could not load GL" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void HeadlessContext::DestroyContext()
+{
+    if (m_Context)
+        OSMesaDestroyContext((OSMesaContext)m_Context);
+
+    delete[] m_OSMesaBuffer;
+}
+
+#else
+
+bool HeadlessContext::CreateContext()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+
+    // Not Mesa, or too old for the surfaceless platform: try whatever the default is
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        std::cout << "[Headless] No EGL display" << std::endl;
+        return false;
+    }
+    m_Display = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "[Headless] EGL has no desktop OpenGL" << std::endl;
+        return false;
+    }
+
+    // The context is only ever used surfaceless, any GL capable config will do
+    const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+    for (const int* version : s_ContextVersions)
+    {
+        const EGLint attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, version[0],
+            EGL_CONTEXT_MINOR_VERSION, version[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+
+        m_Context = eglCreateContext(display, configCount ? config : EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+        if (m_Context != EGL_NO_CONTEXT)
+            break;
+    }
+
+    if (m_Context == EGL_NO_CONTEXT)
+    {
+        std::cout << "[Headless] EGL could not create a core profile context" << std::endl;
+        return false;
+    }
+
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, (EGLContext)m_Context))
+    {
+        std::cout << "[Headless] eglMakeCurrent without a surface failed" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+    {
+        std::cout << "[Headless] glad could not load GL" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void HeadlessContext::DestroyContext()
+{
+    if (!m_Display)
+        return;
+
+    eglMakeCurrent((EGLDisplay)m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_Context != EGL_NO_CONTEXT)
+        eglDestroyContext((EGLDisplay)m_Display, (EGLContext)m_Context);
+    eglTerminate((EGLDisplay)m_Display);
+}
+
+#endif
+
+bool HeadlessContext::CreateFramebuffer()
+{
+    GLCall(glGenRenderbuffers(1, &m_ColorBuffer));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_ColorBuffer));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_Width, m_Height));
+
+    GLCall(glGenRenderbuffers(1, &m_DepthBuffer));
+    GLCall(glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer));
+    GLCall(glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height));
+
+    GLCall(glGenFramebuffers(1, &m_Framebuffer));
+    GLCall(glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_ColorBuffer));
+    GLCall(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer));
+
+    unsigned int status;
+    GLCall(status = glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "[Headless] Framebuffer incomplete: 0x" << std::hex << status << std::dec << std::endl;
+        return false;
+    }
+
+    Bind();
+
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+/*
+ GL context without a window, for benchmarks on build servers.
+
+ By default it comes from EGL on Mesa's surfaceless platform
+ (EGL_MESA_platform_surfaceless), which needs no display server and runs
+ on llvmpipe when there is no GPU. Building with HEADLESS_OSMESA uses
+ OSMesa instead, for Mesa builds without EGL.
+
+ Either way everything is drawn into an RGBA8 + depth framebuffer object
+ of the requested size, bound for as long as the context lives. Check
+ IsValid() after construction, failures are printed to std::cout.
+ */
+class HeadlessContext
+{
+private:
+    void* m_Display;
+    void* m_Context;
+    unsigned char* m_OSMesaBuffer;
+
+    unsigned int m_Framebuffer;
+    unsigned int m_ColorBuffer;
+    unsigned int m_DepthBuffer;
+    int m_Width, m_Height;
+
+    bool m_Valid;
+
+public:
+    HeadlessContext(int width, int height);
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // Rebinds the offscreen framebuffer and viewport, e.g. after ImGui
+    void Bind() const;
+
+    inline bool IsValid() const { return m_Valid; }
+    inline int GetWidth() const { return m_Width; }
+    inline int GetHeight() const { return m_Height; }
+    inline unsigned int GetFramebuffer() const { return m_Framebuffer; }
+
+private:
+    bool CreateContext();
+    void DestroyContext();
+    bool CreateFramebuffer();
+};
@@ -0,0 +1,218 @@
+/*
+ Measures JobSystem: what scheduling one job costs, and how a compute
+ bound ParallelFor scales with 1, 2, 4, ... threads up to --threads
+ (at most 64). No GL needed.
+
+ Overhead is timed on empty jobs, so it is all queueing, stealing and
+ counting: Run() + Wait() of --jobs jobs from the calling thread, in
+ batches that fit its job pool, then ParallelFor over --jobs items with
+ a grain of 1. Scaling runs --work iterations of arithmetic per item
+ over --items items; efficiency is the speedup divided by the thread
+ count. Threads beyond the machine's cores only show what
+ oversubscription costs.
+
+ Build and run on Linux from 4-Batching:
+   g++ -std=gnu++17 -O2 Benchmark/JobBenchmark.cpp JobSystem.cpp \
+       -lpthread -o job-benchmark
+   ./job-benchmark --threads 64 --csv scaling.csv
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../JobSystem.hpp"
+
+static const int s_MaxThreads = 64;
+static const int s_ChartWidth = 50;
+// Jobs queued before waiting for them
+static const int s_Batch = 1024;
+
+struct Options
+{
+    int Jobs = 100000;
+    int Items = 4096;
+    int Work = 20000;
+    int Runs = 5;
+    int Threads = std::min(s_MaxThreads, (int)std::max(1u, std::thread::hardware_concurrency()));
+    std::string Csv;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--help" || i + 1 >= argc)
+            return false;
+
+        const char* value = argv[++i];
+
+        if      (flag == "--jobs")      options.Jobs = atoi(value);
+        else if (flag == "--items")     options.Items = atoi(value);
+        else if (flag == "--work")      options.Work = atoi(value);
+        else if (flag == "--runs")      options.Runs = atoi(value);
+        else if (flag == "--threads")   options.Threads = atoi(value);
+        else if (flag == "--csv")       options.Csv = value;
+        else
+            return false;
+    }
+
+    return options.Jobs > 0 && options.Items > 0 && options.Work > 0 && options.Runs > 0 &&
+           options.Threads > 0 && options.Threads <= s_MaxThreads;
+}
+
+template<typename Run>
+static double medianMs(int runs, Run run)
+{
+    std::vector<double> ms;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+// Enough dependent arithmetic that the compiler cannot fold it away
+static float compute(uint32_t item, int work)
+{
+    float value = (float)item;
+    for (int i = 0; i < work; i++)
+        value = std::sqrt(value * 1.0001f + 1.0f);
+    return value;
+}
+
+static void printOverhead(const char* name, int threads, int jobs, double ms)
+{
+    std::cout << "  " << name << ", " << threads << " threads: " << ms * 1e6 / jobs << " ns/job" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "usage: " << argv[0] << " [--jobs N] [--items N] [--work N] [--runs N] [--threads 1-64] [--csv FILE]" << std::endl;
+        return 2;
+    }
+
+    std::cout << "Overhead of " << options.Jobs << " empty jobs:" << std::endl;
+    for (int threads : { 1, options.Threads })
+    {
+        JobSystem jobs(threads - 1);
+        std::atomic<uint32_t> ran(0);
+
+        double runMs = medianMs(options.Runs, [&]
+        {
+            // In batches that fit the pool, beyond it Run() calls the function right away
+            for (int batch = 0; batch < options.Jobs; batch += s_Batch)
+            {
+                JobCounter counter;
+                for (int i = batch; i < std::min(batch + s_Batch, options.Jobs); i++)
+                    jobs.Run(counter, [&ran] { ran.fetch_add(1, std::memory_order_relaxed); });
+                jobs.Wait(counter);
+            }
+        });
+        printOverhead("Run + Wait", threads, options.Jobs, runMs);
+
+        double forMs = medianMs(options.Runs, [&]
+        {
+            jobs.ParallelFor(0, options.Jobs, 1, [&ran](uint32_t begin, uint32_t end)
+            {
+                ran.fetch_add(end - begin, std::memory_order_relaxed);
+            });
+        });
+        printOverhead("ParallelFor, grain 1", threads, options.Jobs, forMs);
+
+        if (ran != (uint32_t)options.Jobs * 2 * options.Runs)
+        {
+            std::cout << "  Ran " << ran << " jobs, expected " << options.Jobs * 2 * options.Runs << std::endl;
+            return 1;
+        }
+
+        JobSystem::Stats stats = jobs.GetStats();
+        std::cout << "  " << stats.Executed << " queued, " << stats.Stolen << " stolen, " << stats.Inline << " run inline" << std::endl;
+
+        if (threads == options.Threads)
+            break;
+    }
+
+    // 1, 2, 4, ... and --threads itself when it is not a power of two
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < options.Threads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(options.Threads);
+
+    std::vector<float> expected(options.Items);
+    for (int i = 0; i < options.Items; i++)
+        expected[i] = compute(i, options.Work);
+
+    std::cout << std::endl << "Scaling, " << options.Items << " items of " << options.Work << " iterations ("
+              << std::thread::hardware_concurrency() << " hardware threads):" << std::endl;
+
+    std::vector<double> times;
+    for (int threads : threadCounts)
+    {
+        JobSystem jobs(threads - 1);
+        std::vector<float> results(options.Items);
+
+        times.push_back(medianMs(options.Runs, [&]
+        {
+            jobs.ParallelFor(0, options.Items, 16, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t i = begin; i < end; i++)
+                    results[i] = compute(i, options.Work);
+            });
+        }));
+
+        if (results != expected)
+        {
+            std::cout << "  " << threads << " threads computed different results" << std::endl;
+            return 1;
+        }
+    }
+
+    double bestSpeedup = 0.0;
+    for (double ms : times)
+        bestSpeedup = std::max(bestSpeedup, times[0] / ms);
+
+    for (size_t i = 0; i < threadCounts.size(); i++)
+    {
+        double speedup = times[0] / times[i];
+        int bar = (int)std::round(speedup / bestSpeedup * s_ChartWidth);
+
+        char line[128];
+        snprintf(line, sizeof(line), "  %2d threads %9.2f ms %6.2fx %5.1f%% ", threadCounts[i], times[i],
+                 speedup, speedup / threadCounts[i] * 100.0);
+        std::cout << line << std::string(bar, '#') << std::endl;
+    }
+
+    if (!options.Csv.empty())
+    {
+        std::ofstream csv(options.Csv);
+        csv << "threads,ms,speedup,efficiency" << std::endl;
+        for (size_t i = 0; i < threadCounts.size(); i++)
+            csv << threadCounts[i] << "," << times[i] << "," << times[0] / times[i] << ","
+                << times[0] / times[i] / threadCounts[i] << std::endl;
+
+        if (!csv)
+        {
+            std::cout << "Could not write " << options.Csv << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ Parses a generated shader library with the old getline/stringstream
+ parser and with ShaderParser, and prints the time per parse for each
+ and how it compares with the old parser. No GL needed, only the text
+ handling is measured.
+
+ The library is --shaders .shader files, each with a vertex and a
+ fragment stage of --lines lines, every stage including two of
+ --includes shared files. It is written to --dir (a temporary directory
+ by default) and parsed --runs times:
+   legacy   getline into two stringstreams, the shader alone
+   cold     ShaderParser with its include cache cleared before every run
+   cached   ShaderParser with the include cache kept between runs,
+            includes are only stat()ed
+ Input MB/s counts the .shader files only, the same bytes for all
+ three, so it tracks the time. ShaderParser also expands the includes
+ and adds #line directives: the output size is printed next to it, but
+ more output is more work, not a faster parser.
+
+ Build and run on Linux from 4-Batching:
+   g++ -std=gnu++17 -O2 Benchmark/ShaderParserBenchmark.cpp ShaderParser.cpp \
+       -lpthread -o shader-parser-benchmark
+   ./shader-parser-benchmark --shaders 2000 --runs 5
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../ShaderParser.hpp"
+
+struct Options
+{
+    int Shaders = 1000;
+    int Includes = 32;
+    int Lines = 200;
+    int Runs = 5;
+    std::string Dir;
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--help" || i + 1 >= argc)
+            return false;
+
+        const char* value = argv[++i];
+
+        if      (flag == "--shaders")   options.Shaders = atoi(value);
+        else if (flag == "--includes")  options.Includes = atoi(value);
+        else if (flag == "--lines")     options.Lines = atoi(value);
+        else if (flag == "--runs")      options.Runs = atoi(value);
+        else if (flag == "--dir")       options.Dir = value;
+        else
+            return false;
+    }
+
+    return options.Shaders > 0 && options.Includes > 0 && options.Lines > 0 && options.Runs > 0;
+}
+
+// What Shader::Parse did before ShaderParser
+static void parseLegacy(const std::string& filepath, std::string& vertexSource, std::string& fragmentSource)
+{
+    std::ifstream stream(filepath);
+
+    enum class ShaderType
+    { NONE = -1, VERTEX = 0, FRAGMENT = 1 };
+
+    std::string      line;
+    std::stringstream ss[2];
+    ShaderType type = ShaderType::NONE;
+
+    while (getline(stream, line))
+    {
+        if (line.find("#shader") != std::string::npos)
+        {
+            if (line.find("vertex") != std::string::npos)
+                type = ShaderType::VERTEX;
+            else if (line.find("fragment") != std::string::npos)
+                type = ShaderType::FRAGMENT;
+        }
+        else if (type != ShaderType::NONE)
+            ss[(int)type] << line << '\n';
+    }
+
+    vertexSource = ss[0].str();
+    fragmentSource = ss[1].str();
+}
+
+static void writeBody(std::ofstream& stream, int lines, int seed)
+{
+    for (int i = 0; i < lines; i++)
+        stream << "    value" << (i % 8) << " = value" << ((i + seed) % 8) << " * 0.5 + vec4(" << i << ".0); // step " << i << '\n';
+}
+
+static std::vector<std::string> writeLibrary(const Options& options, const std::string& dir)
+{
+    mkdir((dir + "/include").c_str(), 0755);
+
+    for (int i = 0; i < options.Includes; i++)
+    {
+        std::ofstream stream(dir + "/include/common" + std::to_string(i) + ".glsl");
+        stream << "vec4 common" << i << "(vec4 value0)\n{\n";
+        stream << "    vec4 value1, value2, value3, value4, value5, value6, value7;\n";
+        writeBody(stream, options.Lines / 4, i);
+        stream << "    return value0;\n}\n";
+    }
+
+    std::vector<std::string> files;
+    for (int i = 0; i < options.Shaders; i++)
+    {
+        std::string path = dir + "/shader" + std::to_string(i) + ".shader";
+        std::ofstream stream(path);
+
+        const char* stages[] = { "vertex", "fragment" };
+        for (int stage = 0; stage < 2; stage++)
+        {
+            stream << "#shader " << stages[stage] << '\n';
+            stream << "#version 330 core\n";
+            stream << "#include \"include/common" << (i + stage) % options.Includes << ".glsl\"\n";
+            stream << "#include \"include/common" << (i * 7 + stage) % options.Includes << ".glsl\"\n";
+            stream << "void main()\n{\n";
+            stream << "    vec4 value0, value1, value2, value3, value4, value5, value6, value7;\n";
+            writeBody(stream, options.Lines, i + stage);
+            stream << "}\n";
+        }
+
+        files.push_back(path);
+    }
+
+    return files;
+}
+
+// Returns the median ms of a run over every file
+template<typename Parse>
+static double measure(const char* name, const Options& options, size_t inputBytes, Parse parse)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<double> runMs;
+    size_t outputBytes = 0;
+
+    for (int run = 0; run < options.Runs; run++)
+    {
+        auto start = Clock::now();
+        outputBytes = parse(run);
+        runMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+
+    // The first run pays for a cold page cache too
+    std::sort(runMs.begin(), runMs.end());
+    double ms = runMs[runMs.size() / 2];
+
+    std::cout << name << ": " << ms << " ms, " << ms * 1000.0 / options.Shaders << " us per shader, "
+              << (inputBytes / (1024.0 * 1024.0)) / (ms / 1000.0) << " input MB/s, "
+              << outputBytes / 1024 << " KB out" << std::endl;
+    return ms;
+}
+
+static void compare(const char* name, double ms, double legacyMs)
+{
+    if (ms <= legacyMs)
+        std::cout << "  " << name << " is " << legacyMs / ms << "x as fast as legacy" << std::endl;
+    else
+        std::cout << "  " << name << " is " << (ms / legacyMs - 1.0) * 100.0 << "% slower than legacy" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "usage: " << argv[0] << " [--shaders N] [--includes N] [--lines N] [--runs N] [--dir path]" << std::endl;
+        return 2;
+    }
+
+    std::string dir = options.Dir;
+    if (dir.empty())
+    {
+        char pattern[] = "/tmp/shader-library-XXXXXX";
+        if (!mkdtemp(pattern))
+        {
+            std::cout << "Could not create a temporary directory" << std::endl;
+            return 1;
+        }
+        dir = pattern;
+    }
+    else
+        mkdir(dir.c_str(), 0755);
+
+    std::vector<std::string> files = writeLibrary(options, dir);
+    std::cout << files.size() << " shaders, " << options.Includes << " includes in " << dir << std::endl;
+
+    size_t inputBytes = 0;
+    for (const std::string& file : files)
+        inputBytes += std::filesystem::file_size(file);
+
+    double legacyMs = measure("legacy", options, inputBytes, [&](int)
+    {
+        size_t bytes = 0;
+        std::string vertexSource, fragmentSource;
+        for (const std::string& file : files)
+        {
+            parseLegacy(file, vertexSource, fragmentSource);
+            bytes += vertexSource.size() + fragmentSource.size();
+        }
+        return bytes;
+    });
+
+    double coldMs = measure("cold", options, inputBytes, [&](int)
+    {
+        ShaderParser::ClearIncludeCache();
+
+        size_t bytes = 0;
+        for (const std::string& file : files)
+        {
+            ShaderProgramSource source = ShaderParser::Parse(file);
+            bytes += source.VertexSource.size() + source.FragmentSource.size();
+        }
+        return bytes;
+    });
+
+    double cachedMs = measure("cached", options, inputBytes, [&](int)
+    {
+        size_t bytes = 0;
+        for (const std::string& file : files)
+        {
+            ShaderProgramSource source = ShaderParser::Parse(file);
+            bytes += source.VertexSource.size() + source.FragmentSource.size();
+        }
+        return bytes;
+    });
+
+    compare("cold", coldMs, legacyMs);
+    compare("cached", cachedMs, legacyMs);
+
+    ShaderParser::Stats stats = ShaderParser::GetStats();
+    std::cout << stats.FilesRead << " files read, " << stats.IncludeCacheHits << " include cache hits" << std::endl;
+
+    if (options.Dir.empty())
+    {
+        std::error_code error;
+        std::filesystem::remove_all(dir, error);
+        if (error)
+            std::cout << "Could not remove " << dir << ": " << error.message() << std::endl;
+    }
+
+    return 0;
+}
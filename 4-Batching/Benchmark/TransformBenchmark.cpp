@@ -0,0 +1,141 @@
+/*
+ Times building world and MVP matrices for --count transforms: the
+ glm::translate/rotate/scale chain main.cpp used per draw, against
+ TransformSystem with 1, 2, 4, ... threads up to --threads. No GL
+ needed. Also checks that both produce the same matrices.
+
+ Build and run on Linux from 4-Batching:
+   g++ -std=gnu++17 -O2 Benchmark/TransformBenchmark.cpp TransformSystem.cpp \
+       JobSystem.cpp -lpthread -o transform-benchmark
+   ./transform-benchmark --count 1000000 --runs 20
+ Add -mavx2 -mfma to let the compiler use the wider instructions for the
+ scalar parts as well.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../JobSystem.hpp"
+#include "../TransformSystem.hpp"
+
+#include "../vendor/glm/gtc/matrix_transform.hpp"
+
+struct Options
+{
+    int Count = 1000000;
+    int Runs = 20;
+    int Threads = (int)std::max(1u, std::thread::hardware_concurrency());
+};
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--help" || i + 1 >= argc)
+            return false;
+
+        const char* value = argv[++i];
+
+        if      (flag == "--count")     options.Count = atoi(value);
+        else if (flag == "--runs")      options.Runs = atoi(value);
+        else if (flag == "--threads")   options.Threads = atoi(value);
+        else
+            return false;
+    }
+
+    return options.Count > 0 && options.Runs > 0 && options.Threads > 0;
+}
+
+template<typename Run>
+static double medianMs(int runs, Run run)
+{
+    std::vector<double> ms;
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(ms.begin(), ms.end());
+    return ms[ms.size() / 2];
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "usage: " << argv[0] << " [--count N] [--runs N] [--threads N]" << std::endl;
+        return 2;
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+
+    std::vector<glm::vec3> positions(options.Count), scales(options.Count);
+    std::vector<glm::quat> rotations(options.Count);
+    for (int i = 0; i < options.Count; i++)
+    {
+        positions[i] = glm::vec3(position(rng), position(rng), 0.0f);
+        rotations[i] = glm::angleAxis(angle(rng), glm::normalize(glm::vec3(0.2f, 0.3f, 1.0f)));
+        scales[i] = glm::vec3(scale(rng), scale(rng), 1.0f);
+    }
+
+    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(-5.0f, 3.0f, 0.0f));
+
+    std::vector<glm::mat4> world(options.Count), mvp(options.Count);
+    double glmMs = medianMs(options.Runs, [&]
+    {
+        for (int i = 0; i < options.Count; i++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]) * glm::mat4_cast(rotations[i]);
+            world[i] = glm::scale(model, scales[i]);
+            mvp[i] = proj * view * world[i];
+        }
+    });
+    std::cout << options.Count << " transforms, glm per object: " << glmMs << " ms" << std::endl;
+
+    // 1, 2, 4, ... and --threads itself when it is not a power of two
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < options.Threads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(options.Threads);
+
+    for (int threads : threadCounts)
+    {
+        JobSystem jobs(threads - 1);
+        TransformSystem transforms(&jobs);
+        for (int i = 0; i < options.Count; i++)
+            transforms.Add(positions[i], rotations[i], scales[i]);
+
+        double ms = medianMs(options.Runs, [&] { transforms.Update(proj * view); });
+
+        float maxError = 0.0f;
+        for (int i = 0; i < options.Count; i += 97)
+        {
+            for (int column = 0; column < 4; column++)
+            {
+                glm::vec4 difference = glm::abs(transforms.GetMVPMatrices()[i][column] - mvp[i][column]) +
+                                       glm::abs(transforms.GetWorldMatrices()[i][column] - world[i][column]);
+                maxError = std::max(maxError, std::max(std::max(difference.x, difference.y), std::max(difference.z, difference.w)));
+            }
+        }
+
+        std::cout << "TransformSystem, " << transforms.GetStats().Threads << " threads: " << ms << " ms ("
+                  << glmMs / ms << "x), max error " << maxError << std::endl;
+    }
+
+    return 0;
+}
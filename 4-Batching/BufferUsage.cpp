@@ -0,0 +1,48 @@
+#include "BufferUsage.hpp"
+#include "Renderer.h"
+
+unsigned int GetGLUsage(BufferUsage usage)
+{
+    switch (usage)
+    {
+        case BufferUsage::STATIC:   return GL_STATIC_DRAW;
+        case BufferUsage::DYNAMIC:  return GL_DYNAMIC_DRAW;
+        case BufferUsage::STREAM:   return GL_STREAM_DRAW;
+    }
+    
+    ASSERT(false);
+    
+    return GL_STATIC_DRAW;
+}
+
+unsigned int GrowCapacity(unsigned int capacity, unsigned int required)
+{
+    unsigned int grown = capacity + capacity / 2;
+    return grown > required ? grown : required;
+}
+
+void ReallocateBuffer(unsigned int id, unsigned int keepBytes, unsigned int capacity, BufferUsage usage)
+{
+    if (keepBytes == 0)
+    {
+        GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, id));
+        GLCall(glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GetGLUsage(usage)));
+        return;
+    }
+    
+    // glBufferData drops the old store, so park the contents in a scratch buffer first
+    unsigned int scratch;
+    GLCall(glGenBuffers(1, &scratch));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, scratch));
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, keepBytes, nullptr, GL_STREAM_COPY));
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, id));
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes));
+    
+    GLCall(glBufferData(GL_COPY_READ_BUFFER, capacity, nullptr, GetGLUsage(usage)));
+    
+    GLCall(glBindBuffer(GL_COPY_READ_BUFFER, scratch));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, id));
+    GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes));
+    
+    GLCall(glDeleteBuffers(1, &scratch));
+}
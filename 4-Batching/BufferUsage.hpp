@@ -0,0 +1,14 @@
+#pragma once
+
+// How often a buffer's contents are expected to change, maps to GL_*_DRAW
+enum class BufferUsage
+{ STATIC = 0, DYNAMIC = 1, STREAM = 2 };
+
+unsigned int GetGLUsage(BufferUsage usage);
+
+// Capacity for `required` bytes, growing by at least half so repeated growth stays amortized O(1)
+unsigned int GrowCapacity(unsigned int capacity, unsigned int required);
+
+// Gives buffer `id` a new store of `capacity` bytes and keeps its first `keepBytes`.
+// Uses the copy targets only, so no vertex array's element buffer is disturbed.
+void ReallocateBuffer(unsigned int id, unsigned int keepBytes, unsigned int capacity, BufferUsage usage);
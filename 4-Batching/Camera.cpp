@@ -0,0 +1,123 @@
+#include <atomic>
+
+#include "Camera.hpp"
+
+#include "vendor/glm/gtc/matrix_transform.hpp"
+
+// Shared by every camera, so no two states ever carry the same version
+static std::atomic<uint64_t> s_NextVersion(1);
+
+Camera::Camera()
+:   m_View(1.0f),
+    m_Projection(1.0f),
+    m_ViewProjection(1.0f),
+    m_InverseViewProjection(1.0f),
+    m_Version(s_NextVersion++)
+{
+}
+
+void Camera::Recalculate()
+{
+    m_ViewProjection = m_Projection * m_View;
+    m_InverseViewProjection = glm::inverse(m_ViewProjection);
+    m_Version = s_NextVersion++;
+}
+
+OrthographicCamera::OrthographicCamera(float left, float right, float bottom, float top, float zNear, float zFar)
+:   m_Position(0.0f),
+    m_Rotation(0.0f)
+{
+    SetProjection(left, right, bottom, top, zNear, zFar);
+}
+
+void OrthographicCamera::SetProjection(float left, float right, float bottom, float top, float zNear, float zFar)
+{
+    glm::mat4 projection = glm::ortho(left, right, bottom, top, zNear, zFar);
+    if (projection == m_Projection)
+        return;
+
+    m_Projection = projection;
+    Recalculate();
+}
+
+void OrthographicCamera::SetPosition(const glm::vec3& position)
+{
+    if (position == m_Position)
+        return;
+
+    m_Position = position;
+    RecalculateView();
+}
+
+void OrthographicCamera::SetRotation(float rotation)
+{
+    if (rotation == m_Rotation)
+        return;
+
+    m_Rotation = rotation;
+    RecalculateView();
+}
+
+void OrthographicCamera::RecalculateView()
+{
+    // The camera's transform, inverted: everything moves the other way
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), m_Position) *
+                          glm::rotate(glm::mat4(1.0f), m_Rotation, glm::vec3(0.0f, 0.0f, 1.0f));
+    m_View = glm::inverse(transform);
+    Recalculate();
+}
+
+PerspectiveCamera::PerspectiveCamera(float fovY, float aspect, float zNear, float zFar)
+:   m_Position(0.0f),
+    m_Orientation(1.0f, 0.0f, 0.0f, 0.0f)
+{
+    SetProjection(fovY, aspect, zNear, zFar);
+}
+
+void PerspectiveCamera::SetProjection(float fovY, float aspect, float zNear, float zFar)
+{
+    glm::mat4 projection = glm::perspective(fovY, aspect, zNear, zFar);
+    if (projection == m_Projection)
+        return;
+
+    m_Projection = projection;
+    Recalculate();
+}
+
+void PerspectiveCamera::SetPosition(const glm::vec3& position)
+{
+    if (position == m_Position)
+        return;
+
+    m_Position = position;
+    RecalculateView();
+}
+
+void PerspectiveCamera::SetOrientation(const glm::quat& orientation)
+{
+    if (orientation == m_Orientation)
+        return;
+
+    m_Orientation = orientation;
+    RecalculateView();
+}
+
+void PerspectiveCamera::LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up)
+{
+    // lookAt builds the view directly, its inverse rotation is the orientation
+    glm::mat4 view = glm::lookAt(eye, target, up);
+    glm::quat orientation = glm::conjugate(glm::quat_cast(glm::mat3(view)));
+    if (eye == m_Position && orientation == m_Orientation)
+        return;
+
+    m_Position = eye;
+    m_Orientation = orientation;
+    RecalculateView();
+}
+
+void PerspectiveCamera::RecalculateView()
+{
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), m_Position) * glm::mat4_cast(m_Orientation);
+    m_View = glm::inverse(transform);
+    Recalculate();
+}
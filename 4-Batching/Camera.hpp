@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+
+#include "vendor/glm/glm.hpp"
+#include "vendor/glm/gtc/quaternion.hpp"
+
+/*
+ View, projection, their product and its inverse, recomputed only when
+ a setter actually changes something.
+
+ Every change takes a new version from one counter shared by all
+ cameras, so a version identifies both the camera and its state.
+ Consumers remember the version their derived data (a uniform, cull
+ bounds, cached MVPs) was built from and rebuild only when it differs:
+ a static camera costs a comparison per frame. Setting the same value
+ again is not a change.
+ */
+class Camera
+{
+protected:
+    glm::mat4 m_View;
+    glm::mat4 m_Projection;
+    glm::mat4 m_ViewProjection;
+    glm::mat4 m_InverseViewProjection;
+    uint64_t m_Version;
+
+public:
+    Camera();
+
+    inline const glm::mat4& GetView() const { return m_View; }
+    inline const glm::mat4& GetProjection() const { return m_Projection; }
+    inline const glm::mat4& GetViewProjection() const { return m_ViewProjection; }
+    inline const glm::mat4& GetInverseViewProjection() const { return m_InverseViewProjection; }
+    // Never 0, so 0 works as "nothing built yet"
+    inline uint64_t GetVersion() const { return m_Version; }
+
+protected:
+    // After m_View or m_Projection changed
+    void Recalculate();
+};
+
+class OrthographicCamera : public Camera
+{
+private:
+    glm::vec3 m_Position;
+    float m_Rotation;            // Radians, around z
+
+public:
+    OrthographicCamera(float left, float right, float bottom, float top, float zNear = -1.0f, float zFar = 1.0f);
+
+    void SetProjection(float left, float right, float bottom, float top, float zNear = -1.0f, float zFar = 1.0f);
+    void SetPosition(const glm::vec3& position);
+    void SetRotation(float rotation);
+
+    inline const glm::vec3& GetPosition() const { return m_Position; }
+    inline float GetRotation() const { return m_Rotation; }
+
+private:
+    void RecalculateView();
+};
+
+class PerspectiveCamera : public Camera
+{
+private:
+    glm::vec3 m_Position;
+    glm::quat m_Orientation;
+
+public:
+    // `fovY` in radians
+    PerspectiveCamera(float fovY, float aspect, float zNear = 0.1f, float zFar = 1000.0f);
+
+    void SetProjection(float fovY, float aspect, float zNear = 0.1f, float zFar = 1000.0f);
+    void SetPosition(const glm::vec3& position);
+    void SetOrientation(const glm::quat& orientation);
+    // Position and orientation at once
+    void LookAt(const glm::vec3& eye, const glm::vec3& target, const glm::vec3& up = glm::vec3(0.0f, 1.0f, 0.0f));
+
+    inline const glm::vec3& GetPosition() const { return m_Position; }
+    inline const glm::quat& GetOrientation() const { return m_Orientation; }
+
+private:
+    void RecalculateView();
+};
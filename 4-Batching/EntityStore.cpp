@@ -0,0 +1,588 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "EntityStore.hpp"
+#include "BatchRenderer2D.hpp"
+#include "Camera.hpp"
+
+static inline uint32_t componentBit(ComponentType type)
+{
+    return 1u << (uint32_t)type;
+}
+
+// Moves the last element into `row`, on an empty column (component not in the mask) it does nothing
+template<typename T>
+static void swapRemove(std::vector<T>& column, uint32_t row)
+{
+    if (column.empty())
+        return;
+
+    column[row] = column.back();
+    column.pop_back();
+}
+
+EntityStore::EntityStore(float cellSize)
+:   m_Update(0),
+    m_SpatialIndex(cellSize),
+    m_ViewVersion(0),
+    m_ViewMin(0.0f),
+    m_ViewMax(0.0f)
+{
+}
+
+const EntityStore::Record* EntityStore::Lookup(Entity entity) const
+{
+    if (entity.Index >= m_Records.size())
+        return nullptr;
+
+    const Record& record = m_Records[entity.Index];
+    return record.Alive && record.Generation == entity.Generation ? &record : nullptr;
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+    return Lookup(entity) != nullptr;
+}
+
+uint32_t EntityStore::GetArchetype(uint32_t mask, uint32_t depth)
+{
+    auto found = m_ArchetypeIndex.find({ mask, depth });
+    if (found != m_ArchetypeIndex.end())
+        return found->second;
+
+    uint32_t index = (uint32_t)m_Archetypes.size();
+    m_Archetypes.emplace_back();
+    m_Archetypes.back().Mask = mask;
+    m_Archetypes.back().Depth = depth;
+    m_ArchetypeIndex[{ mask, depth }] = index;
+
+    auto position = std::upper_bound(m_ByDepth.begin(), m_ByDepth.end(), depth, [this](uint32_t d, uint32_t archetype)
+    {
+        return d < m_Archetypes[archetype].Depth;
+    });
+    m_ByDepth.insert(position, index);
+
+    return index;
+}
+
+Entity EntityStore::Create()
+{
+    uint32_t index;
+    if (!m_Free.empty())
+    {
+        index = m_Free.back();
+        m_Free.pop_back();
+    }
+    else
+    {
+        index = (uint32_t)m_Records.size();
+        m_Records.emplace_back();
+    }
+
+    Entity entity = { index, m_Records[index].Generation };
+    uint32_t archetype = GetArchetype(0, 0);
+
+    Record& record = m_Records[index];
+    record.Archetype = archetype;
+    record.Row = (uint32_t)m_Archetypes[archetype].Entities.size();
+    record.Alive = true;
+    m_Archetypes[archetype].Entities.push_back(entity);
+
+    return entity;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+    if (!Lookup(entity))
+        return;
+
+    for (Entity child : FindChildren(entity))
+        Destroy(child);
+
+    Record& record = m_Records[entity.Index];
+    RemoveRow(record.Archetype, record.Row);
+    m_SpatialIndex.Remove(entity.Index);
+    record.Alive = false;
+    record.Generation++;
+    m_Free.push_back(entity.Index);
+}
+
+void EntityStore::Clear()
+{
+    for (uint32_t i = 0; i < (uint32_t)m_Records.size(); i++)
+    {
+        if (!m_Records[i].Alive)
+            continue;
+
+        m_Records[i].Alive = false;
+        m_Records[i].Generation++;
+        m_Free.push_back(i);
+    }
+
+    // Archetypes stay, the same scene is likely to be built again
+    for (Archetype& archetype : m_Archetypes)
+    {
+        archetype.Entities.clear();
+        archetype.Transforms.clear();
+        archetype.WorldTransforms.clear();
+        archetype.Dirty.clear();
+        archetype.Updated.clear();
+        archetype.Sprites.clear();
+        archetype.Colors.clear();
+        archetype.Parents.clear();
+    }
+
+    m_SpatialIndex.Clear();
+}
+
+void EntityStore::RemoveRow(uint32_t archetype, uint32_t row)
+{
+    Archetype& a = m_Archetypes[archetype];
+
+    uint32_t last = (uint32_t)a.Entities.size() - 1;
+    if (row != last)
+        m_Records[a.Entities[last].Index].Row = row;
+
+    swapRemove(a.Entities, row);
+    swapRemove(a.Transforms, row);
+    swapRemove(a.WorldTransforms, row);
+    swapRemove(a.Dirty, row);
+    swapRemove(a.Updated, row);
+    swapRemove(a.Sprites, row);
+    swapRemove(a.Colors, row);
+    swapRemove(a.Parents, row);
+}
+
+void EntityStore::Move(Entity entity, uint32_t mask, uint32_t depth)
+{
+    Record& record = m_Records[entity.Index];
+    uint32_t from = record.Archetype;
+    uint32_t row = record.Row;
+
+    // May grow m_Archetypes, so both references are taken after it
+    uint32_t to = GetArchetype(mask, depth);
+    if (to == from)
+        return;
+
+    Archetype& source = m_Archetypes[from];
+    Archetype& destination = m_Archetypes[to];
+
+    destination.Entities.push_back(entity);
+
+    if (mask & componentBit(ComponentType::TRANSFORM))
+    {
+        bool had = source.Mask & componentBit(ComponentType::TRANSFORM);
+        destination.Transforms.push_back(had ? source.Transforms[row] : TransformComponent());
+        destination.WorldTransforms.push_back(had ? source.WorldTransforms[row] : glm::mat4(1.0f));
+        // The parent may be a different one now
+        destination.Dirty.push_back(1);
+        destination.Updated.push_back(0);
+    }
+
+    if (mask & componentBit(ComponentType::SPRITE))
+    {
+        bool had = source.Mask & componentBit(ComponentType::SPRITE);
+        destination.Sprites.push_back(had ? source.Sprites[row] : SpriteComponent());
+    }
+
+    if (mask & componentBit(ComponentType::COLOR))
+    {
+        bool had = source.Mask & componentBit(ComponentType::COLOR);
+        destination.Colors.push_back(had ? source.Colors[row] : ColorComponent());
+    }
+
+    if (mask & componentBit(ComponentType::PARENT))
+    {
+        bool had = source.Mask & componentBit(ComponentType::PARENT);
+        destination.Parents.push_back(had ? source.Parents[row] : ParentComponent());
+    }
+
+    // Only drawable entities are indexed, the others would only slow down queries
+    uint32_t drawable = componentBit(ComponentType::TRANSFORM) | componentBit(ComponentType::SPRITE);
+    if ((mask & drawable) != drawable)
+        m_SpatialIndex.Remove(entity.Index);
+
+    RemoveRow(from, row);
+    record.Archetype = to;
+    record.Row = (uint32_t)destination.Entities.size() - 1;
+}
+
+void EntityStore::AddTransform(Entity entity, const TransformComponent& transform)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    if (!(archetype.Mask & componentBit(ComponentType::TRANSFORM)))
+        Move(entity, archetype.Mask | componentBit(ComponentType::TRANSFORM), archetype.Depth);
+
+    SetTransform(entity, transform);
+}
+
+void EntityStore::AddSprite(Entity entity, const SpriteComponent& sprite)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    if (!(archetype.Mask & componentBit(ComponentType::SPRITE)))
+        Move(entity, archetype.Mask | componentBit(ComponentType::SPRITE), archetype.Depth);
+
+    Archetype& moved = m_Archetypes[record->Archetype];
+    moved.Sprites[record->Row] = sprite;
+
+    // The size is part of the bounding box in the grid
+    if (moved.Mask & componentBit(ComponentType::TRANSFORM))
+        moved.Dirty[record->Row] = 1;
+}
+
+void EntityStore::AddColor(Entity entity, const ColorComponent& color)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    if (!(archetype.Mask & componentBit(ComponentType::COLOR)))
+        Move(entity, archetype.Mask | componentBit(ComponentType::COLOR), archetype.Depth);
+
+    m_Archetypes[record->Archetype].Colors[record->Row] = color;
+}
+
+void EntityStore::SetParent(Entity entity, Entity parent)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    uint32_t transform = componentBit(ComponentType::TRANSFORM);
+    uint32_t parentBit = componentBit(ComponentType::PARENT);
+
+    if (!parent.IsValid())
+    {
+        uint32_t mask = m_Archetypes[record->Archetype].Mask;
+        if (!(mask & parentBit))
+            return;
+
+        Move(entity, mask & ~parentBit, 0);
+        UpdateChildDepths(entity, 0);
+        return;
+    }
+
+    if (!IsAlive(parent))
+        return;
+
+    // A cycle would have no root to start the propagation from
+    for (Entity ancestor = parent; ancestor.IsValid(); ancestor = GetParent(ancestor))
+    {
+        if (ancestor == entity)
+            return;
+    }
+
+    if (!GetTransform(parent))
+        AddTransform(parent);
+
+    uint32_t depth = m_Archetypes[m_Records[parent.Index].Archetype].Depth + 1;
+    Move(entity, m_Archetypes[record->Archetype].Mask | transform | parentBit, depth);
+
+    Archetype& archetype = m_Archetypes[record->Archetype];
+    archetype.Parents[record->Row].Parent = parent;
+    archetype.Dirty[record->Row] = 1;
+
+    UpdateChildDepths(entity, depth);
+}
+
+void EntityStore::RemoveComponent(Entity entity, ComponentType type)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    if (archetype.Mask & componentBit(type))
+        Move(entity, archetype.Mask & ~componentBit(type), archetype.Depth);
+}
+
+void EntityStore::RemoveSprite(Entity entity)
+{
+    RemoveComponent(entity, ComponentType::SPRITE);
+}
+
+void EntityStore::RemoveColor(Entity entity)
+{
+    RemoveComponent(entity, ComponentType::COLOR);
+}
+
+std::vector<Entity> EntityStore::FindChildren(Entity entity) const
+{
+    std::vector<Entity> children;
+    for (const Archetype& archetype : m_Archetypes)
+    {
+        if (!(archetype.Mask & componentBit(ComponentType::PARENT)))
+            continue;
+
+        for (uint32_t row = 0; row < (uint32_t)archetype.Parents.size(); row++)
+        {
+            if (archetype.Parents[row].Parent == entity)
+                children.push_back(archetype.Entities[row]);
+        }
+    }
+
+    return children;
+}
+
+void EntityStore::UpdateChildDepths(Entity entity, uint32_t depth)
+{
+    for (Entity child : FindChildren(entity))
+    {
+        const Record& record = m_Records[child.Index];
+        const Archetype& archetype = m_Archetypes[record.Archetype];
+
+        // Already right below, so is everything under it
+        if (archetype.Depth == depth + 1)
+            continue;
+
+        Move(child, archetype.Mask, depth + 1);
+        UpdateChildDepths(child, depth + 1);
+    }
+}
+
+const TransformComponent* EntityStore::GetTransform(Entity entity) const
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return nullptr;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    return archetype.Mask & componentBit(ComponentType::TRANSFORM) ? &archetype.Transforms[record->Row] : nullptr;
+}
+
+SpriteComponent* EntityStore::GetSprite(Entity entity)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return nullptr;
+
+    Archetype& archetype = m_Archetypes[record->Archetype];
+    return archetype.Mask & componentBit(ComponentType::SPRITE) ? &archetype.Sprites[record->Row] : nullptr;
+}
+
+ColorComponent* EntityStore::GetColor(Entity entity)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return nullptr;
+
+    Archetype& archetype = m_Archetypes[record->Archetype];
+    return archetype.Mask & componentBit(ComponentType::COLOR) ? &archetype.Colors[record->Row] : nullptr;
+}
+
+Entity EntityStore::GetParent(Entity entity) const
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return Entity();
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    return archetype.Mask & componentBit(ComponentType::PARENT) ? archetype.Parents[record->Row].Parent : Entity();
+}
+
+const glm::mat4* EntityStore::GetWorldTransform(Entity entity) const
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return nullptr;
+
+    const Archetype& archetype = m_Archetypes[record->Archetype];
+    return archetype.Mask & componentBit(ComponentType::TRANSFORM) ? &archetype.WorldTransforms[record->Row] : nullptr;
+}
+
+void EntityStore::SetTransform(Entity entity, const TransformComponent& transform)
+{
+    const Record* record = Lookup(entity);
+    if (!record)
+        return;
+
+    Archetype& archetype = m_Archetypes[record->Archetype];
+    if (!(archetype.Mask & componentBit(ComponentType::TRANSFORM)))
+        return;
+
+    archetype.Transforms[record->Row] = transform;
+    archetype.Dirty[record->Row] = 1;
+}
+
+void EntityStore::SetPosition(Entity entity, const glm::vec3& position)
+{
+    if (const TransformComponent* transform = GetTransform(entity))
+    {
+        TransformComponent changed = *transform;
+        changed.Position = position;
+        SetTransform(entity, changed);
+    }
+}
+
+void EntityStore::SetRotation(Entity entity, float rotation)
+{
+    if (const TransformComponent* transform = GetTransform(entity))
+    {
+        TransformComponent changed = *transform;
+        changed.Rotation = rotation;
+        SetTransform(entity, changed);
+    }
+}
+
+void EntityStore::UpdateTransforms()
+{
+    m_Update++;
+    unsigned int updated = 0;
+
+    for (uint32_t index : m_ByDepth)
+    {
+        Archetype& archetype = m_Archetypes[index];
+        if (!(archetype.Mask & componentBit(ComponentType::TRANSFORM)))
+            continue;
+
+        bool hasParent = archetype.Mask & componentBit(ComponentType::PARENT);
+        bool hasSprite = archetype.Mask & componentBit(ComponentType::SPRITE);
+
+        for (uint32_t row = 0; row < (uint32_t)archetype.Entities.size(); row++)
+        {
+            // Shallower archetypes are done, so the parent's matrix is final
+            const glm::mat4* parentWorld = nullptr;
+            bool parentUpdated = false;
+            if (hasParent)
+            {
+                const Record& parent = m_Records[archetype.Parents[row].Parent.Index];
+                const Archetype& parentArchetype = m_Archetypes[parent.Archetype];
+                parentWorld = &parentArchetype.WorldTransforms[parent.Row];
+                parentUpdated = parentArchetype.Updated[parent.Row] == m_Update;
+            }
+
+            if (!archetype.Dirty[row] && !parentUpdated)
+                continue;
+
+            // T * Rz * S, written out
+            const TransformComponent& transform = archetype.Transforms[row];
+            float c = std::cos(transform.Rotation);
+            float s = std::sin(transform.Rotation);
+
+            glm::mat4 local(1.0f);
+            local[0] = glm::vec4(c * transform.Scale.x, s * transform.Scale.x, 0.0f, 0.0f);
+            local[1] = glm::vec4(-s * transform.Scale.y, c * transform.Scale.y, 0.0f, 0.0f);
+            local[3] = glm::vec4(transform.Position, 1.0f);
+
+            const glm::mat4& world = archetype.WorldTransforms[row] = parentWorld ? *parentWorld * local : local;
+            archetype.Dirty[row] = 0;
+            archetype.Updated[row] = m_Update;
+            updated++;
+
+            if (hasSprite)
+            {
+                // Box around the rotated quad: each axis reaches half its length either way
+                const glm::vec2 size = archetype.Sprites[row].Size;
+                glm::vec2 center(world[3]);
+                glm::vec2 half = 0.5f * (glm::abs(glm::vec2(world[0])) * size.x + glm::abs(glm::vec2(world[1])) * size.y);
+                m_SpatialIndex.Update(archetype.Entities[row].Index, center - half, center + half);
+            }
+        }
+    }
+
+    m_Stats.Entities = GetCount();
+    m_Stats.Archetypes = (unsigned int)m_Archetypes.size();
+    m_Stats.TransformsUpdated = updated;
+}
+
+void EntityStore::DrawSprites(BatchRenderer2D& batch)
+{
+    uint32_t required = componentBit(ComponentType::TRANSFORM) | componentBit(ComponentType::SPRITE);
+    unsigned int drawn = 0;
+
+    for (uint32_t index : m_ByDepth)
+    {
+        const Archetype& archetype = m_Archetypes[index];
+        if ((archetype.Mask & required) != required)
+            continue;
+
+        batch.DrawQuads((uint32_t)archetype.Entities.size(),
+            [&archetype](uint32_t row) { return archetype.Sprites[row].Texture; },
+            [&archetype](uint32_t row, float texIndex, QuadVertex* vertices)
+            {
+                WriteSprite(archetype, row, texIndex, vertices);
+            });
+
+        drawn += (unsigned int)archetype.Entities.size();
+    }
+
+    m_Stats.SpritesDrawn = drawn;
+    m_Stats.SpritesCulled = 0;
+}
+
+void EntityStore::DrawSprites(BatchRenderer2D& batch, const Camera& camera)
+{
+    if (camera.GetVersion() != m_ViewVersion)
+    {
+        // The view in world space: the clip space cube mapped back, near and far plane
+        const glm::mat4& inverse = camera.GetInverseViewProjection();
+        m_ViewMin = glm::vec2(std::numeric_limits<float>::max());
+        m_ViewMax = glm::vec2(-std::numeric_limits<float>::max());
+        for (int corner = 0; corner < 8; corner++)
+        {
+            glm::vec4 point = inverse * glm::vec4(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f,
+                                                  corner & 4 ? 1.0f : -1.0f, 1.0f);
+            glm::vec2 world = glm::vec2(point) / point.w;
+            m_ViewMin = glm::min(m_ViewMin, world);
+            m_ViewMax = glm::max(m_ViewMax, world);
+        }
+
+        m_ViewVersion = camera.GetVersion();
+    }
+
+    m_Visible.clear();
+    m_SpatialIndex.Query(m_ViewMin, m_ViewMax, m_Visible);
+
+    // Cells come back in grid order, sort by archetype and row to draw as the unculled path would
+    std::vector<uint32_t> rank(m_Archetypes.size());
+    for (uint32_t i = 0; i < (uint32_t)m_ByDepth.size(); i++)
+        rank[m_ByDepth[i]] = i;
+
+    m_DrawOrder.clear();
+    for (uint32_t index : m_Visible)
+    {
+        const Record& record = m_Records[index];
+        m_DrawOrder.push_back((uint64_t)rank[record.Archetype] << 32 | record.Row);
+    }
+    std::sort(m_DrawOrder.begin(), m_DrawOrder.end());
+
+    batch.DrawQuads((uint32_t)m_DrawOrder.size(),
+        [this](uint32_t i)
+        {
+            uint64_t key = m_DrawOrder[i];
+            return m_Archetypes[m_ByDepth[key >> 32]].Sprites[(uint32_t)key].Texture;
+        },
+        [this](uint32_t i, float texIndex, QuadVertex* vertices)
+        {
+            uint64_t key = m_DrawOrder[i];
+            WriteSprite(m_Archetypes[m_ByDepth[key >> 32]], (uint32_t)key, texIndex, vertices);
+        });
+
+    m_Stats.SpritesDrawn = (unsigned int)m_Visible.size();
+    m_Stats.SpritesCulled = m_SpatialIndex.GetStats().Items - m_Stats.SpritesDrawn;
+}
+
+void EntityStore::WriteSprite(const Archetype& archetype, uint32_t row, float texIndex, QuadVertex* vertices)
+{
+    const SpriteComponent& sprite = archetype.Sprites[row];
+    const glm::mat4& world = archetype.WorldTransforms[row];
+    const glm::vec4 color = archetype.Mask & componentBit(ComponentType::COLOR) ? archetype.Colors[row].Color : glm::vec4(1.0f);
+
+    // The unit quad stretched to the sprite's size, in the entity's space
+    glm::mat4 transform(world[0] * sprite.Size.x, world[1] * sprite.Size.y, world[2], world[3]);
+
+    if (sprite.Texture)
+        BatchRenderer2D::WriteQuad(vertices, transform, color, texIndex, sprite.UVMin, sprite.UVMax);
+    else
+        BatchRenderer2D::WriteQuad(vertices, transform, color, texIndex);
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "SpatialGrid.hpp"
+
+#include "vendor/glm/glm.hpp"
+
+class BatchRenderer2D;
+class Camera;
+class Texture;
+struct QuadVertex;
+
+// Slot in the store plus the slot's generation, like a ResourceHandle
+struct Entity
+{
+    uint32_t Index = 0xFFFFFFFF;
+    uint32_t Generation = 0;
+
+    inline bool IsValid() const { return Index != 0xFFFFFFFF; }
+    inline bool operator==(const Entity& other) const { return Index == other.Index && Generation == other.Generation; }
+    inline bool operator!=(const Entity& other) const { return !(*this == other); }
+};
+
+// Relative to the parent, if there is one
+struct TransformComponent
+{
+    glm::vec3 Position = glm::vec3(0.0f);
+    float Rotation = 0.0f;               // Radians, around z
+    glm::vec2 Scale = glm::vec2(1.0f);
+};
+
+struct SpriteComponent
+{
+    glm::vec2 Size = glm::vec2(1.0f);
+    const ::Texture* Texture = nullptr;  // Null for a flat colored quad
+    glm::vec2 UVMin = glm::vec2(0.0f);
+    glm::vec2 UVMax = glm::vec2(1.0f);
+};
+
+// Flat color or texture tint, white without one
+struct ColorComponent
+{
+    glm::vec4 Color = glm::vec4(1.0f);
+};
+
+struct ParentComponent
+{
+    Entity Parent;
+};
+
+enum class ComponentType
+{ TRANSFORM = 0, SPRITE = 1, COLOR = 2, PARENT = 3 };
+
+/*
+ Entities and their components, stored by archetype: every entity with
+ the same set of components (and, for transforms, the same depth in the
+ hierarchy) shares one Archetype, which keeps each component in its own
+ tightly packed array. Systems walk those arrays front to back, so
+ drawing 100k sprites streams through memory instead of following a
+ pointer per object. Adding or removing a component moves the entity's
+ row to another archetype, the last row of the old one fills the gap.
+
+ Transforms are local to the parent. SetTransform() marks the entity
+ dirty and UpdateTransforms() rebuilds the world matrix of dirty
+ entities and of every descendant of one, nothing else. Archetypes are
+ visited by depth, so a parent is always done before its children.
+ Reparenting or destroying an entity with children walks the store and
+ is meant for scene setup, not every frame.
+
+ Every sprite's world bounding box is kept in a SpatialGrid, refreshed
+ along with its transform, so DrawSprites() with a view-projection only
+ touches the few cells on screen however large the world is. Change a
+ sprite's size with AddSprite(), not through GetSprite(), or the grid
+ keeps the old box. The view rectangle is only worked out again when
+ the camera's version changes.
+
+ Sprites go to the batch through DrawQuads(), so their vertices are
+ written on the batch's JobSystem when it has one.
+
+ Pointers from Get*() are valid until the next structural change
+ (creating or destroying an entity, adding or removing a component).
+ */
+class EntityStore
+{
+public:
+    struct Stats
+    {
+        unsigned int Entities = 0;
+        unsigned int Archetypes = 0;
+        unsigned int TransformsUpdated = 0;  // Last UpdateTransforms()
+        unsigned int SpritesDrawn = 0;       // Last DrawSprites()
+        unsigned int SpritesCulled = 0;      // Last DrawSprites() with a view-projection
+    };
+
+private:
+    struct Archetype
+    {
+        uint32_t Mask = 0;                   // 1 << ComponentType for every component
+        uint32_t Depth = 0;                  // Ancestors with a transform
+        std::vector<Entity> Entities;        // Row to entity
+        // A column is empty unless Mask has its component
+        std::vector<TransformComponent> Transforms;
+        std::vector<glm::mat4> WorldTransforms;
+        std::vector<uint8_t> Dirty;
+        std::vector<uint32_t> Updated;       // UpdateTransforms() that last rebuilt the row
+        std::vector<SpriteComponent> Sprites;
+        std::vector<ColorComponent> Colors;
+        std::vector<ParentComponent> Parents;
+    };
+
+    struct Record
+    {
+        uint32_t Generation = 1;             // Starts at 1, a default Entity never matches
+        uint32_t Archetype = 0;
+        uint32_t Row = 0;
+        bool Alive = false;
+    };
+
+    std::vector<Record> m_Records;
+    std::vector<uint32_t> m_Free;
+    std::vector<Archetype> m_Archetypes;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> m_ArchetypeIndex;  // (mask, depth)
+    std::vector<uint32_t> m_ByDepth;         // Archetype indices, shallowest first
+    uint32_t m_Update;
+
+    SpatialGrid m_SpatialIndex;              // Sprites by entity index
+    std::vector<uint32_t> m_Visible;
+    std::vector<uint64_t> m_DrawOrder;       // Rank of the archetype in m_ByDepth, row
+    // World rectangle the camera sees, as of m_ViewVersion
+    uint64_t m_ViewVersion;
+    glm::vec2 m_ViewMin, m_ViewMax;
+
+    Stats m_Stats;
+
+public:
+    // `cellSize` of the sprite grid in world units, around the size of a typical sprite or larger
+    EntityStore(float cellSize = 8.0f);
+
+    EntityStore(const EntityStore&) = delete;
+    EntityStore& operator=(const EntityStore&) = delete;
+
+    // Without components
+    Entity Create();
+    // Destroys the entity's children with it
+    void Destroy(Entity entity);
+    bool IsAlive(Entity entity) const;
+    void Clear();
+
+    // Add* replaces an existing component of the same type
+    void AddTransform(Entity entity, const TransformComponent& transform = TransformComponent());
+    void AddSprite(Entity entity, const SpriteComponent& sprite = SpriteComponent());
+    void AddColor(Entity entity, const ColorComponent& color = ColorComponent());
+    // Adds a default transform to both if they have none. An invalid parent
+    // detaches. Ignored if `parent` is `entity` or one of its descendants
+    void SetParent(Entity entity, Entity parent);
+    void RemoveSprite(Entity entity);
+    void RemoveColor(Entity entity);
+
+    // Null if the entity is stale or lacks the component
+    const TransformComponent* GetTransform(Entity entity) const;
+    SpriteComponent* GetSprite(Entity entity);
+    ColorComponent* GetColor(Entity entity);
+    Entity GetParent(Entity entity) const;
+    // As of the last UpdateTransforms()
+    const glm::mat4* GetWorldTransform(Entity entity) const;
+
+    // Transforms are written through these so they get marked dirty
+    void SetTransform(Entity entity, const TransformComponent& transform);
+    void SetPosition(Entity entity, const glm::vec3& position);
+    void SetRotation(Entity entity, float rotation);
+
+    // Rebuilds the world matrices of dirty entities and their descendants
+    void UpdateTransforms();
+    // Every entity with a transform and a sprite, parents before children
+    void DrawSprites(BatchRenderer2D& batch);
+    // Only those overlapping the camera's view, same order. Call after UpdateTransforms()
+    void DrawSprites(BatchRenderer2D& batch, const Camera& camera);
+
+    inline uint32_t GetCount() const { return (uint32_t)(m_Records.size() - m_Free.size()); }
+    inline const Stats& GetStats() const { return m_Stats; }
+    inline const SpatialGrid& GetSpatialIndex() const { return m_SpatialIndex; }
+
+private:
+    const Record* Lookup(Entity entity) const;
+    uint32_t GetArchetype(uint32_t mask, uint32_t depth);
+    // Moves the entity's row to the archetype for `mask` and `depth`, new components default
+    void Move(Entity entity, uint32_t mask, uint32_t depth);
+    void RemoveRow(uint32_t archetype, uint32_t row);
+    void RemoveComponent(Entity entity, ComponentType type);
+    // Direct children, found by scanning every archetype with a parent
+    std::vector<Entity> FindChildren(Entity entity) const;
+    // Moves the children of `entity` below its new depth, recursively
+    void UpdateChildDepths(Entity entity, uint32_t depth);
+    // The row's quad, for BatchRenderer2D::DrawQuads()
+    static void WriteSprite(const Archetype& archetype, uint32_t row, float texIndex, QuadVertex* vertices);
+};
@@ -0,0 +1,213 @@
+#include <cstring>
+#include <iostream>
+
+#include "FrameCapture.hpp"
+#include "ImageWriter.hpp"
+#include "Renderer.h"
+
+FrameCapture::FrameCapture(unsigned int ringSize, unsigned int maxQueued)
+:   m_Ring(ringSize > 0 ? ringSize : 1),
+    m_Next(0),
+    m_Oldest(0),
+    m_InFlight(0),
+    m_MaxQueued(maxQueued > 0 ? maxQueued : 1),
+    m_JobsRunning(0),
+    m_Quit(false)
+{
+    for (Readback& readback : m_Ring)
+    {
+        GLCall(glGenBuffers(1, &readback.PixelBuffer));
+    }
+
+    m_Worker = std::thread(&FrameCapture::WorkerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    Finish();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_JobAdded.notify_all();
+    m_Worker.join();
+
+    for (Readback& readback : m_Ring)
+    {
+        GLCall(glDeleteBuffers(1, &readback.PixelBuffer));
+    }
+}
+
+void FrameCapture::Capture(const std::string& filepath, Format format, int width, int height, unsigned int framebuffer)
+{
+    // Every buffer is in flight, the oldest has to come back first
+    if (m_InFlight == m_Ring.size())
+    {
+        m_Stats.Stalls++;
+        Retire(true);
+    }
+
+    Readback& readback = m_Ring[m_Next];
+    readback.Width = width;
+    readback.Height = height;
+    readback.Path = filepath;
+    readback.FileFormat = format;
+
+    // The read buffer belongs to the framebuffer, put it back before leaving it
+    int previousFramebuffer, previousReadBuffer;
+    GLCall(glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousFramebuffer));
+    GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+    GLCall(glGetIntegerv(GL_READ_BUFFER, &previousReadBuffer));
+    GLCall(glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK));
+
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PixelBuffer));
+
+    unsigned int size = width * height * 4;
+    if (size != readback.Size)
+    {
+        GLCall(glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ));
+        readback.Size = size;
+    }
+
+    // With a pack buffer bound the last argument is an offset, the call returns right away
+    GLCall(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+    GLCall(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr));
+    GLCall(readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GLCall(glReadBuffer(previousReadBuffer));
+    GLCall(glBindFramebuffer(GL_READ_FRAMEBUFFER, previousFramebuffer));
+
+    m_Next = (m_Next + 1) % m_Ring.size();
+    m_InFlight++;
+    m_Stats.Captured++;
+}
+
+void FrameCapture::Update()
+{
+    // Readbacks finish in order, stop at the first one still running
+    while (m_InFlight > 0)
+    {
+        if (!Retire(false))
+            break;
+    }
+}
+
+void FrameCapture::Finish()
+{
+    while (m_InFlight > 0)
+        Retire(true);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_JobDone.wait(lock, [this] { return m_Jobs.empty() && m_JobsRunning == 0; });
+}
+
+bool FrameCapture::Retire(bool wait)
+{
+    // The worker is behind: leave the readback in the ring until it catches up
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_Jobs.size() >= m_MaxQueued)
+        {
+            if (!wait)
+                return false;
+
+            m_Stats.QueueStalls++;
+            m_JobDone.wait(lock, [this] { return m_Jobs.size() < m_MaxQueued; });
+        }
+    }
+
+    Readback& readback = m_Ring[m_Oldest];
+    GLsync fence = (GLsync)readback.Fence;
+
+    unsigned int result;
+    GLCall(result = glClientWaitSync(fence, 0, 0));
+
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        if (!wait)
+            return false;
+
+        do
+        {
+            GLCall(result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+        }
+        while (result == GL_TIMEOUT_EXPIRED);
+    }
+
+    GLCall(glDeleteSync(fence));
+    readback.Fence = nullptr;
+
+    Job job;
+    job.Width = readback.Width;
+    job.Height = readback.Height;
+    job.Path = readback.Path;
+    job.FileFormat = readback.FileFormat;
+    job.Pixels.resize(readback.Size);
+
+    void* pixels;
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PixelBuffer));
+    GLCall(pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readback.Size, GL_MAP_READ_BIT));
+    if (pixels)
+    {
+        memcpy(job.Pixels.data(), pixels, readback.Size);
+        GLCall(glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    GLCall(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    m_Oldest = (m_Oldest + 1) % m_Ring.size();
+    m_InFlight--;
+
+    if (!pixels)
+    {
+        m_Stats.Failed++;
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back(std::move(job));
+    }
+    m_JobAdded.notify_one();
+
+    return true;
+}
+
+void FrameCapture::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        m_JobAdded.wait(lock, [this] { return m_Quit || !m_Jobs.empty(); });
+        if (m_Jobs.empty())
+            return;
+
+        Job job = std::move(m_Jobs.front());
+        m_Jobs.pop_front();
+        m_JobsRunning++;
+        m_JobDone.notify_all();
+        lock.unlock();
+
+        // GL rows are bottom-up: start at the last one and walk backwards
+        int stride = job.Width * 4;
+        const unsigned char* topRow = job.Pixels.data() + (size_t)(job.Height - 1) * stride;
+
+        bool written = job.FileFormat == Format::PNG
+            ? WritePng(job.Path, job.Width, job.Height, topRow, -stride)
+            : WriteRaw(job.Path, job.Width, job.Height, topRow, -stride);
+
+        if (written)
+            m_Stats.Written++;
+        else
+        {
+            m_Stats.Failed++;
+            std::cout << "[FrameCapture] Could not write " << job.Path << std::endl;
+        }
+
+        lock.lock();
+        m_JobsRunning--;
+        m_JobDone.notify_all();
+    }
+}
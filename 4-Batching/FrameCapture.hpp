@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ Reads framebuffers back without stalling the pipeline.
+
+ Capture() only queues glReadPixels into a pixel pack buffer and puts a
+ fence behind it. Update(), once a frame, maps the buffers whose fence
+ has signaled, normally two or three frames later, copies the pixels out
+ and hands them to a worker thread that writes the PNG or raw file.
+
+ The ring has one pack buffer per capture in flight. Capturing every
+ frame with a ring shorter than the GPU's latency makes Capture() wait
+ on the oldest fence, which is counted as a stall.
+
+ At most `maxQueued` files wait for the worker. While the queue is full
+ Update() leaves finished readbacks in the ring, so Capture() ends up
+ waiting for the worker instead (a queue stall) and memory stays bounded
+ however far encoding falls behind. A PNG of a 1080p frame takes tens of
+ milliseconds to encode; record RAW to keep up with the frame rate.
+
+ Capture the default framebuffer before swapping buffers, it reads
+ GL_BACK. Render thread only, apart from the worker it owns.
+ */
+class FrameCapture
+{
+public:
+    enum class Format
+    { PNG = 0, RAW = 1 };
+
+    struct Stats
+    {
+        unsigned int Captured = 0;    // Readbacks queued
+        unsigned int Stalls = 0;      // Captures that waited on the GPU for a free buffer
+        unsigned int QueueStalls = 0; // Captures that waited on the worker for room in its queue
+        std::atomic<unsigned int> Written { 0 };
+        std::atomic<unsigned int> Failed { 0 };
+    };
+
+private:
+    struct Readback
+    {
+        unsigned int PixelBuffer = 0;
+        unsigned int Size = 0;
+        void* Fence = nullptr;
+        int Width = 0, Height = 0;
+        std::string Path;
+        Format FileFormat = Format::PNG;
+    };
+
+    struct Job
+    {
+        std::vector<unsigned char> Pixels; // Bottom-up, as GL reads them
+        int Width, Height;
+        std::string Path;
+        Format FileFormat;
+    };
+
+    std::vector<Readback> m_Ring;
+    unsigned int m_Next;    // Slot the next Capture() uses
+    unsigned int m_Oldest;  // Oldest slot still in flight
+    unsigned int m_InFlight;
+
+    std::thread m_Worker;
+    std::mutex m_Mutex;
+    std::condition_variable m_JobAdded;
+    std::condition_variable m_JobDone;
+    std::deque<Job> m_Jobs;
+    unsigned int m_MaxQueued;
+    unsigned int m_JobsRunning;
+    bool m_Quit;
+
+    Stats m_Stats;
+
+public:
+    FrameCapture(unsigned int ringSize = 3, unsigned int maxQueued = 4);
+    ~FrameCapture();
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    // Queues a readback of `width` x `height` from `framebuffer` (0 = default) into `filepath`
+    void Capture(const std::string& filepath, Format format, int width, int height, unsigned int framebuffer = 0);
+
+    // Hands every readback the GPU has finished to the worker, never blocks
+    void Update();
+
+    // Waits for every queued readback and file, e.g. at the end of a session
+    void Finish();
+
+    inline unsigned int GetInFlight() const { return m_InFlight; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    // Maps the oldest readback and queues its job, waiting on its fence and the queue if `wait`
+    bool Retire(bool wait);
+    void WorkerLoop();
+};
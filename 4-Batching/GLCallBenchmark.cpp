@@ -0,0 +1,60 @@
+#include <chrono>
+
+#include "GLCallBenchmark.hpp"
+
+// One function per flavour: the macro picks the wrapper at compile time
+#define DEFINE_DRAW_LOOP(name, wrap) \
+static double name(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, \
+                   int location, const glm::mat4& mvp, unsigned int draws) \
+{ \
+    glFinish(); \
+    auto start = std::chrono::steady_clock::now(); \
+    for (unsigned int i = 0; i < draws; i++) \
+    { \
+        wrap(glUseProgram(shader.GetRendererID())); \
+        wrap(glBindVertexArray(va.GetRendererID())); \
+        wrap(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib.GetRendererID())); \
+        wrap(glUniformMatrix4fv(location, 1, GL_FALSE, &mvp[0][0])); \
+        wrap(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr)); \
+    } \
+    auto end = std::chrono::steady_clock::now(); \
+    return std::chrono::duration<double, std::nano>(end - start).count() / draws; \
+}
+
+DEFINE_DRAW_LOOP(DrawBare, GLCALL_BARE)
+DEFINE_DRAW_LOOP(DrawGetError, GLCALL_GET_ERROR)
+DEFINE_DRAW_LOOP(DrawDebugOutput, GLCALL_DEBUG_OUTPUT)
+
+GLCallBenchmarkResult RunGLCallBenchmark(const VertexArray& va, const IndexBuffer& ib,
+                                         const Shader& shader, const glm::mat4& mvp,
+                                         unsigned int draws)
+{
+    GLCallBenchmarkResult result;
+    
+    UniformHandle mvpUniform = shader.GetUniformHandle("u_MVP"_uniform);
+    int location = mvpUniform.IsValid() ? shader.GetUniforms()[mvpUniform.index].location : -1;
+    bool debugOutput = g_GLDebugOutput;
+    
+    // The first two flavours must not pay for the driver's debug layer
+    if (debugOutput)
+        glDisable(GL_DEBUG_OUTPUT);
+    g_GLDebugOutput = false;
+    
+    result.Bare     = DrawBare(va, ib, shader, location, mvp, draws);
+    result.GetError = DrawGetError(va, ib, shader, location, mvp, draws);
+    
+    result.DebugOutputAvailable = debugOutput || GLEnableDebugOutput();
+    if (result.DebugOutputAvailable)
+    {
+        glEnable(GL_DEBUG_OUTPUT);
+        g_GLDebugOutput = true;
+    }
+    
+    result.DebugOutput = DrawDebugOutput(va, ib, shader, location, mvp, draws);
+    
+    if (!debugOutput && result.DebugOutputAvailable)
+        glDisable(GL_DEBUG_OUTPUT);
+    g_GLDebugOutput = debugOutput;
+    
+    return result;
+}
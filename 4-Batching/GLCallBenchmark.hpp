@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Renderer.h"
+
+struct GLCallBenchmarkResult
+{
+    // CPU time per draw, nanoseconds
+    double Bare;
+    double GetError;
+    double DebugOutput;
+    // false when KHR_debug is missing and DebugOutput fell back to polling
+    bool DebugOutputAvailable;
+};
+
+/*
+ Times the same draw, bound from scratch (program, vertex array, element
+ buffer, u_MVP and glDrawElements), wrapped with each GLCall flavour.
+ Only submission is timed, the queue is drained before each run.
+ */
+GLCallBenchmarkResult RunGLCallBenchmark(const VertexArray& va, const IndexBuffer& ib,
+                                         const Shader& shader, const glm::mat4& mvp,
+                                         unsigned int draws);
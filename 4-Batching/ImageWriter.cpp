@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "ImageWriter.hpp"
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+    // Built once, thread safe as a function local static
+    static const std::vector<uint32_t> table = []
+    {
+        std::vector<uint32_t> entries(256);
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+        return entries;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static uint32_t adler32(const unsigned char* data, size_t size)
+{
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; i++)
+    {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+// Deflate writes bits least significant first
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& m_Output;
+    uint32_t m_Buffer;
+    int m_Count;
+
+public:
+    BitWriter(std::vector<unsigned char>& output)
+    : m_Output(output), m_Buffer(0), m_Count(0) {}
+
+    void Write(uint32_t bits, int count)
+    {
+        m_Buffer |= bits << m_Count;
+        m_Count += count;
+
+        while (m_Count >= 8)
+        {
+            m_Output.push_back(m_Buffer & 0xFF);
+            m_Buffer >>= 8;
+            m_Count -= 8;
+        }
+    }
+
+    // Huffman codes are defined most significant bit first
+    void WriteCode(uint32_t code, int count)
+    {
+        uint32_t reversed = 0;
+        for (int i = 0; i < count; i++)
+            reversed |= ((code >> i) & 1) << (count - 1 - i);
+
+        Write(reversed, count);
+    }
+
+    void Flush()
+    {
+        if (m_Count > 0)
+            Write(0, 8 - m_Count);
+    }
+};
+
+static const unsigned short s_LengthBase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const unsigned char s_LengthExtra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const unsigned short s_DistanceBase[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const unsigned char s_DistanceExtra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+// Fixed literal/length code (RFC 1951, 3.2.6)
+static void writeSymbol(BitWriter& bits, unsigned int symbol)
+{
+    if (symbol < 144)       bits.WriteCode(0x30 + symbol, 8);
+    else if (symbol < 256)  bits.WriteCode(0x190 + symbol - 144, 9);
+    else if (symbol < 280)  bits.WriteCode(symbol - 256, 7);
+    else                    bits.WriteCode(0xC0 + symbol - 280, 8);
+}
+
+static void writeMatch(BitWriter& bits, unsigned int length, unsigned int distance)
+{
+    int code = 28;
+    while (s_LengthBase[code] > length)
+        code--;
+    writeSymbol(bits, 257 + code);
+    bits.Write(length - s_LengthBase[code], s_LengthExtra[code]);
+
+    code = 29;
+    while (s_DistanceBase[code] > distance)
+        code--;
+    bits.WriteCode(code, 5);
+    bits.Write(distance - s_DistanceBase[code], s_DistanceExtra[code]);
+}
+
+// zlib stream of one fixed Huffman block
+static std::vector<unsigned char> deflate(const std::vector<unsigned char>& data)
+{
+    const unsigned int WindowSize = 32768;
+    const unsigned int MaxMatch = 258;
+    const unsigned int MaxChain = 32;
+    const unsigned int HashBits = 15;
+
+    std::vector<unsigned char> output = { 0x78, 0x01 };
+    BitWriter bits(output);
+    bits.Write(1, 1); // Final block
+    bits.Write(1, 2); // Fixed Huffman codes
+
+    // Most recent position per hash, and the previous position with the same hash
+    std::vector<int> head(1 << HashBits, -1);
+    std::vector<int> previous(data.size(), -1);
+
+    auto hash = [&](size_t i)
+    {
+        uint32_t value = data[i] | data[i + 1] << 8 | data[i + 2] << 16;
+        return (value * 2654435761u) >> (32 - HashBits);
+    };
+
+    auto insert = [&](size_t i)
+    {
+        if (i + 2 >= data.size())
+            return;
+        uint32_t h = hash(i);
+        previous[i] = head[h];
+        head[h] = (int)i;
+    };
+
+    size_t i = 0;
+    while (i < data.size())
+    {
+        unsigned int bestLength = 0, bestDistance = 0;
+
+        if (i + 2 < data.size())
+        {
+            unsigned int limit = (unsigned int)std::min<size_t>(MaxMatch, data.size() - i);
+            int candidate = head[hash(i)];
+
+            for (unsigned int chain = 0; candidate >= 0 && chain < MaxChain; chain++)
+            {
+                if (i - candidate > WindowSize)
+                    break;
+
+                unsigned int length = 0;
+                while (length < limit && data[candidate + length] == data[i + length])
+                    length++;
+
+                if (length > bestLength)
+                {
+                    bestLength = length;
+                    bestDistance = (unsigned int)(i - candidate);
+                    if (length == limit)
+                        break;
+                }
+
+                candidate = previous[candidate];
+            }
+        }
+
+        if (bestLength >= 3)
+        {
+            writeMatch(bits, bestLength, bestDistance);
+            for (unsigned int k = 0; k < bestLength; k++)
+                insert(i + k);
+            i += bestLength;
+        }
+        else
+        {
+            writeSymbol(bits, data[i]);
+            insert(i);
+            i++;
+        }
+    }
+
+    writeSymbol(bits, 256);
+    bits.Flush();
+
+    uint32_t adler = adler32(data.data(), data.size());
+    output.push_back(adler >> 24);
+    output.push_back(adler >> 16);
+    output.push_back(adler >> 8);
+    output.push_back(adler);
+
+    return output;
+}
+
+static void writeChunk(std::ofstream& stream, const char* type, const std::vector<unsigned char>& data)
+{
+    unsigned char header[8] = {
+        (unsigned char)(data.size() >> 24), (unsigned char)(data.size() >> 16),
+        (unsigned char)(data.size() >> 8), (unsigned char)data.size(),
+        (unsigned char)type[0], (unsigned char)type[1], (unsigned char)type[2], (unsigned char)type[3]
+    };
+
+    // The CRC covers the type and the data, not the length
+    uint32_t crc = crc32(header + 4, 4);
+    crc = crc32(data.data(), data.size(), crc);
+    unsigned char footer[4] = {
+        (unsigned char)(crc >> 24), (unsigned char)(crc >> 16), (unsigned char)(crc >> 8), (unsigned char)crc
+    };
+
+    stream.write((const char*)header, 8);
+    stream.write((const char*)data.data(), data.size());
+    stream.write((const char*)footer, 4);
+}
+
+bool WritePng(const std::string& filepath, int width, int height, const unsigned char* pixels, int stride)
+{
+    const int rowSize = width * 4;
+
+    // Filter byte 1 (Sub) per row: each byte minus the same channel of the pixel to its left
+    std::vector<unsigned char> filtered((rowSize + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* row = pixels + (ptrdiff_t)y * stride;
+        unsigned char* out = &filtered[(size_t)y * (rowSize + 1)];
+
+        out[0] = 1;
+        memcpy(out + 1, row, 4);
+        for (int x = 4; x < rowSize; x++)
+            out[1 + x] = row[x] - row[x - 4];
+    }
+
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream)
+        return false;
+
+    const unsigned char signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    stream.write((const char*)signature, sizeof(signature));
+
+    std::vector<unsigned char> header = {
+        (unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+        (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+        8, // Bit depth
+        6, // RGBA
+        0, 0, 0
+    };
+
+    writeChunk(stream, "IHDR", header);
+    writeChunk(stream, "IDAT", deflate(filtered));
+    writeChunk(stream, "IEND", {});
+
+    return (bool)stream;
+}
+
+bool WriteRaw(const std::string& filepath, int width, int height, const unsigned char* pixels, int stride)
+{
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream)
+        return false;
+
+    for (int y = 0; y < height; y++)
+        stream.write((const char*)pixels + (ptrdiff_t)y * stride, width * 4);
+
+    return (bool)stream;
+}
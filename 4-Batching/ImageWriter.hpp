@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+/*
+ Writes 8-bit RGBA pixels, rows top to bottom, `stride` bytes apart. A
+ negative stride from the last row flips a bottom-up GL readback for free.
+
+ stb_image only reads, so the PNG encoder is our own: every row is Sub
+ filtered and compressed with greedy LZ77 and the fixed deflate Huffman
+ codes. It is not as small as zlib's output, but it needs no dependency.
+ */
+bool WritePng(const std::string& filepath, int width, int height, const unsigned char* pixels, int stride);
+
+// The bare pixels, e.g. for ffmpeg -f rawvideo -pix_fmt rgba -s WxH
+bool WriteRaw(const std::string& filepath, int width, int height, const unsigned char* pixels, int stride);
@@ -5,23 +5,56 @@
 //  Created by Ivan on 10.06.2022.
 //
 
+#include <utility>
+
 #include "IndexBuffer.hpp"
 #include "Renderer.h"
 
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
-: m_Count(count)
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage)
+: m_Count(count), m_Capacity(count), m_Usage(usage)
 {
     GLCall(glGenBuffers(1, &m_RendererID));
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, count * sizeof(unsigned int), data, GetGLUsage(usage)));
     
 }
 
+IndexBuffer::IndexBuffer(unsigned int capacity, BufferUsage usage)
+: m_Count(0), m_Capacity(capacity), m_Usage(usage)
+{
+    GLCall(glGenBuffers(1, &m_RendererID));
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, capacity * sizeof(unsigned int), nullptr, GetGLUsage(usage)));
+}
+
 IndexBuffer::~IndexBuffer()
 {
     GLCall(glDeleteBuffers(1, &m_RendererID));
 }
 
+IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
+: m_RendererID(std::exchange(other.m_RendererID, 0)),
+  m_Count(std::exchange(other.m_Count, 0)),
+  m_Capacity(std::exchange(other.m_Capacity, 0)),
+  m_Usage(other.m_Usage)
+{
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        GLCall(glDeleteBuffers(1, &m_RendererID));
+        
+        m_RendererID = std::exchange(other.m_RendererID, 0);
+        m_Count = std::exchange(other.m_Count, 0);
+        m_Capacity = std::exchange(other.m_Capacity, 0);
+        m_Usage = other.m_Usage;
+    }
+    
+    return *this;
+}
+
 void IndexBuffer::Bind() const
 {
     GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RendererID));
@@ -31,3 +64,61 @@ void IndexBuffer::Unbind() const
 {
     GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
 }
+
+void IndexBuffer::SetData(const unsigned int* data, unsigned int count)
+{
+    if (count > m_Capacity)
+        m_Capacity = GrowCapacity(m_Capacity, count);
+    
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(glBufferData(GL_COPY_WRITE_BUFFER, m_Capacity * sizeof(unsigned int), nullptr, GetGLUsage(m_Usage)));
+    GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, 0, count * sizeof(unsigned int), data));
+    
+    m_Count = count;
+}
+
+void IndexBuffer::SetSubData(const unsigned int* data, unsigned int count, unsigned int offset)
+{
+    if (offset + count > m_Capacity)
+        Reserve(GrowCapacity(m_Capacity, offset + count));
+    
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(glBufferSubData(GL_COPY_WRITE_BUFFER, offset * sizeof(unsigned int),
+                           count * sizeof(unsigned int), data));
+    
+    if (offset + count > m_Count)
+        m_Count = offset + count;
+}
+
+void IndexBuffer::Reserve(unsigned int capacity)
+{
+    if (capacity <= m_Capacity)
+        return;
+    
+    ReallocateBuffer(m_RendererID, m_Count * sizeof(unsigned int),
+                     capacity * sizeof(unsigned int), m_Usage);
+    m_Capacity = capacity;
+}
+
+unsigned int* IndexBuffer::Map(unsigned int offset, unsigned int count)
+{
+    if (offset + count > m_Capacity)
+        Reserve(GrowCapacity(m_Capacity, offset + count));
+    
+    if (offset + count > m_Count)
+        m_Count = offset + count;
+    
+    void* data;
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(data = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset * sizeof(unsigned int),
+                                   count * sizeof(unsigned int),
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    return (unsigned int*)data;
+}
+
+void IndexBuffer::Unmap()
+{
+    // Rebind in case something else used the copy target while mapped
+    GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, m_RendererID));
+    GLCall(glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+}
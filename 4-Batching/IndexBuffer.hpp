@@ -6,16 +6,40 @@
 //
 #pragma once
 
+#include "BufferUsage.hpp"
+
+/*
+ Move-only owner of an element buffer, sized in indices. Uploads go through
+ GL_COPY_WRITE_BUFFER rather than GL_ELEMENT_ARRAY_BUFFER, so updating the
+ indices never rebinds the element buffer of whatever vertex array is bound.
+ */
 class IndexBuffer
 {
 private:
     unsigned int m_RendererID;
     unsigned int m_Count;
+    unsigned int m_Capacity;
+    BufferUsage m_Usage;
     
 public:
-    IndexBuffer(const unsigned int* data, unsigned int count);
+    IndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage = BufferUsage::STATIC);
+    // Empty buffer with room for `capacity` indices
+    IndexBuffer(unsigned int capacity, BufferUsage usage = BufferUsage::DYNAMIC);
     ~IndexBuffer();
     
+    IndexBuffer(const IndexBuffer&) = delete;
+    IndexBuffer& operator=(const IndexBuffer&) = delete;
+    IndexBuffer(IndexBuffer&& other) noexcept;
+    IndexBuffer& operator=(IndexBuffer&& other) noexcept;
+    
+    // Counts and offsets are in indices, not bytes
+    void SetData(const unsigned int* data, unsigned int count);
+    void SetSubData(const unsigned int* data, unsigned int count, unsigned int offset);
+    void Reserve(unsigned int capacity);
+    
+    unsigned int* Map(unsigned int offset, unsigned int count);
+    void Unmap();
+    
     void Bind() const;
     void Unbind() const;
     
@@ -23,5 +47,15 @@ public:
     {
         return m_Count;
     }
+    
+    inline unsigned int GetCapacity() const
+    {
+        return m_Capacity;
+    }
+    
+    inline unsigned int GetRendererID() const
+    {
+        return m_RendererID;
+    }
 };
 
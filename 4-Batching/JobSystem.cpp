@@ -0,0 +1,272 @@
+#include <algorithm>
+
+#include "JobSystem.hpp"
+
+// Spins through the deques this many times before a worker goes to sleep
+static const int s_IdleSpins = 64;
+// Pool slots tried before Run() gives up and calls the function itself
+static const int s_AllocateProbes = 8;
+
+// The system and worker the calling thread belongs to
+static thread_local const JobSystem* s_CurrentSystem = nullptr;
+static thread_local void* s_CurrentWorker = nullptr;
+
+bool JobDeque::Push(Job* job)
+{
+    int64_t bottom = m_Bottom.load(std::memory_order_relaxed);
+    int64_t top = m_Top.load(std::memory_order_acquire);
+    if (bottom - top >= Capacity)
+        return false;
+
+    m_Jobs[bottom & (Capacity - 1)].store(job, std::memory_order_relaxed);
+    // The job is visible before the bottom that exposes it to thieves
+    m_Bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    int64_t bottom = m_Bottom.load(std::memory_order_relaxed) - 1;
+    m_Bottom.store(bottom, std::memory_order_relaxed);
+    // Thieves must see the lowered bottom before we read the top
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_Top.load(std::memory_order_relaxed);
+
+    if (top > bottom)
+    {
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* job = m_Jobs[bottom & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // The last one, a thief may be after it too
+        if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        m_Bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+Job* JobDeque::Steal()
+{
+    int64_t top = m_Top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+    if (top >= bottom)
+        return nullptr;
+
+    Job* job = m_Jobs[top & (Capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return job;
+}
+
+JobSystem::JobSystem(int workerCount)
+:   m_Queued(0),
+    m_Sleeping(0),
+    m_Quit(false)
+{
+    if (workerCount < 0)
+        workerCount = (int)std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    for (int i = 0; i <= workerCount; i++)
+    {
+        m_Workers.push_back(std::make_unique<Worker>());
+        m_Workers.back()->Pool = std::vector<Job>(PoolSize);
+    }
+
+    s_CurrentSystem = this;
+    s_CurrentWorker = m_Workers[0].get();
+
+    for (int i = 1; i <= workerCount; i++)
+        m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_all();
+
+    for (std::thread& thread : m_Threads)
+        thread.join();
+
+    if (s_CurrentSystem == this)
+    {
+        s_CurrentSystem = nullptr;
+        s_CurrentWorker = nullptr;
+    }
+}
+
+JobSystem::Worker* JobSystem::GetCurrentWorker()
+{
+    return s_CurrentSystem == this ? (Worker*)s_CurrentWorker : nullptr;
+}
+
+Job* JobSystem::Allocate(Worker& worker)
+{
+    // Skips slots held by long lived jobs (the first halves of a ParallelFor) instead of stopping at them
+    for (int probe = 0; probe < s_AllocateProbes; probe++)
+    {
+        Job& job = worker.Pool[worker.NextJob++ % PoolSize];
+        if (job.Busy.load(std::memory_order_acquire))
+            continue;
+
+        job.Busy.store(true, std::memory_order_relaxed);
+        return &job;
+    }
+
+    return nullptr;
+}
+
+void JobSystem::Submit(Job* job)
+{
+    Worker* worker = GetCurrentWorker();
+    if (!worker || !worker->Deque.Push(job))
+    {
+        if (worker)
+            worker->Inline.fetch_add(1, std::memory_order_relaxed);
+        Execute(job);
+        return;
+    }
+
+    // Paired with the sleeper raising m_Sleeping before it checks m_Queued, one of us sees the other
+    m_Queued.fetch_add(1);
+    if (m_Sleeping.load() > 0)
+    {
+        { std::lock_guard<std::mutex> lock(m_Mutex); }
+        m_Wake.notify_one();
+    }
+}
+
+void JobSystem::Execute(Job* job)
+{
+    JobCounter& counter = *job->Counter;
+    job->Function(job->Data);
+
+    if (job->Heap)
+        delete job;
+    else
+        job->Busy.store(false, std::memory_order_release);
+
+    Finish(counter);
+}
+
+void JobSystem::Finish(JobCounter& counter)
+{
+    counter.m_Finishing.fetch_add(1);
+
+    if (counter.m_Pending.fetch_sub(1) == 1)
+    {
+        std::vector<Job*> waiting;
+        {
+            std::lock_guard<std::mutex> lock(counter.m_Mutex);
+            waiting.swap(counter.m_Waiting);
+        }
+
+        for (Job* job : waiting)
+            Submit(job);
+    }
+
+    counter.m_Finishing.fetch_sub(1);
+}
+
+Job* JobSystem::Take(Worker& worker)
+{
+    Job* job = worker.Deque.Pop();
+
+    if (!job)
+    {
+        // Round robin from where the last successful steal happened
+        uint32_t count = (uint32_t)m_Workers.size();
+        for (uint32_t i = 0; i < count && !job; i++)
+        {
+            uint32_t victim = (worker.Victim + i) % count;
+            Worker& other = *m_Workers[victim];
+            if (&other == &worker)
+                continue;
+
+            job = other.Deque.Steal();
+            if (job)
+            {
+                worker.Victim = victim;
+                worker.Stolen.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    if (job)
+    {
+        m_Queued.fetch_sub(1);
+        worker.Executed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    Worker* worker = GetCurrentWorker();
+
+    while (!counter.IsDone())
+    {
+        Job* job = worker ? Take(*worker) : nullptr;
+        if (job)
+            Execute(job);
+        else
+            std::this_thread::yield();
+    }
+}
+
+void JobSystem::WorkerLoop(unsigned int index)
+{
+    Worker& worker = *m_Workers[index];
+    s_CurrentSystem = this;
+    s_CurrentWorker = &worker;
+
+    int idle = 0;
+    while (true)
+    {
+        if (Job* job = Take(worker))
+        {
+            Execute(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < s_IdleSpins)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Sleeping.fetch_add(1);
+        m_Wake.wait(lock, [this] { return m_Quit || m_Queued.load() > 0; });
+        m_Sleeping.fetch_sub(1);
+
+        if (m_Quit)
+            return;
+        idle = 0;
+    }
+}
+
+JobSystem::Stats JobSystem::GetStats() const
+{
+    Stats stats;
+    for (const std::unique_ptr<Worker>& worker : m_Workers)
+    {
+        stats.Executed += worker->Executed.load(std::memory_order_relaxed);
+        stats.Stolen += worker->Stolen.load(std::memory_order_relaxed);
+        stats.Inline += worker->Inline.load(std::memory_order_relaxed);
+    }
+
+    return stats;
+}
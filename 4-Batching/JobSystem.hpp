@@ -0,0 +1,264 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class JobCounter;
+
+// A function and its captures, stored inline so scheduling never allocates
+struct Job
+{
+    static const unsigned int DataSize = 64;
+
+    void (*Function)(void* data) = nullptr;   // Runs and destroys what Data holds
+    JobCounter* Counter = nullptr;
+    std::atomic<bool> Busy{ false };          // Pool slot not yet free for reuse
+    bool Heap = false;                        // Allocated for a dependency, deleted after running
+    alignas(16) unsigned char Data[DataSize];
+};
+
+/*
+ Jobs outstanding under one counter. Run() adds one, the job finishing
+ takes it away; JobSystem::Wait() returns once it is back at zero.
+ Jobs can also wait for a counter (see JobSystem::Run), they are held
+ here and queued by whichever thread finishes the counter's last job.
+ Must outlive every job counted on it or waiting for it.
+ */
+class JobCounter
+{
+private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> m_Pending{ 0 };
+    // Finish() calls still touching the counter, it must not go away under them
+    std::atomic<uint32_t> m_Finishing{ 0 };
+    std::mutex m_Mutex;
+    std::vector<Job*> m_Waiting;
+
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    // Pending first: a Finish() is counted in m_Finishing before it lowers m_Pending
+    inline bool IsDone() const
+    {
+        return m_Pending.load(std::memory_order_seq_cst) == 0 && m_Finishing.load(std::memory_order_seq_cst) == 0;
+    }
+};
+
+/*
+ Chase-Lev work stealing deque of a fixed capacity. Only the owning
+ thread pushes and pops, at the bottom, so its own most recent (and
+ cache-warm) jobs come first; every other thread steals the oldest from
+ the top, which for ParallelFor() is also the largest range left.
+ */
+class JobDeque
+{
+public:
+    static const int64_t Capacity = 4096;
+
+private:
+    alignas(64) std::atomic<int64_t> m_Top{ 0 };
+    alignas(64) std::atomic<int64_t> m_Bottom{ 0 };
+    std::atomic<Job*> m_Jobs[Capacity];
+
+public:
+    // False when full
+    bool Push(Job* job);
+    // Owner only, null when empty
+    Job* Pop();
+    // Any thread, null when empty or another thread won the race
+    Job* Steal();
+};
+
+/*
+ A pool of worker threads, each with its own JobDeque, that also takes
+ the thread creating it: Run() from that thread or from a job queues on
+ the caller's own deque, idle workers steal from the others. Wait()
+ runs jobs while it waits instead of blocking, so a job may Run() and
+ Wait() on jobs of its own.
+
+ Jobs are small: a lambda of at most Job::DataSize bytes of captures,
+ copied into a slot of the calling thread's pool. When no slot is
+ free, the deque is full, or the caller is some other thread,
+ Run() simply calls the function right away. Order between jobs only
+ exists through counters.
+
+ Texture decoding stays on TextureLoader's own threads: it blocks on
+ file reads, which would stall everything queued behind it here.
+ */
+class JobSystem
+{
+public:
+    struct Stats
+    {
+        uint64_t Executed = 0;   // Taken from a deque and run
+        uint64_t Stolen = 0;     // Of those, taken from another thread's deque
+        uint64_t Inline = 0;     // Run right away by Run(), nothing free to queue it in
+    };
+
+private:
+    static const unsigned int PoolSize = 4096;
+
+    struct alignas(64) Worker
+    {
+        JobDeque Deque;
+        std::vector<Job> Pool;
+        uint32_t NextJob = 0;
+        uint32_t Victim = 0;     // Where the last steal attempt started
+        // Written by the owner only, read by GetStats()
+        std::atomic<uint64_t> Executed{ 0 };
+        std::atomic<uint64_t> Stolen{ 0 };
+        std::atomic<uint64_t> Inline{ 0 };
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;  // [0] belongs to the creating thread
+    std::vector<std::thread> m_Threads;
+
+    std::atomic<int64_t> m_Queued;           // In some deque, not yet taken
+    std::atomic<uint32_t> m_Sleeping;
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    bool m_Quit;
+
+public:
+    // `workerCount` -1 for one less than the hardware threads, 0 to only use the calling thread
+    JobSystem(int workerCount = -1);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queues `function` under `counter`
+    template<typename F>
+    void Run(JobCounter& counter, F&& function);
+    // Queues `function` under `counter` once `dependency` is done
+    template<typename F>
+    void Run(JobCounter& counter, F&& function, JobCounter& dependency);
+    // Runs other jobs until `counter` is done
+    void Wait(JobCounter& counter);
+
+    // function(begin, end) over [begin, end) in pieces of at least `grain`, returns when all are done
+    template<typename F>
+    void ParallelFor(uint32_t begin, uint32_t end, uint32_t grain, const F& function);
+
+    // Threads running jobs, the creating one included
+    inline unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size(); }
+    Stats GetStats() const;
+
+private:
+    // The calling thread's worker in this system, null for any other thread
+    Worker* GetCurrentWorker();
+    // Null when the next few pool slots are still in use
+    Job* Allocate(Worker& worker);
+    template<typename F>
+    static void Store(Job& job, F&& function, JobCounter& counter);
+    // Queues on the calling thread's deque if it can, otherwise runs `job` now
+    void Submit(Job* job);
+    void Execute(Job* job);
+    // Takes one from the counter, queuing what waited for it to reach zero
+    void Finish(JobCounter& counter);
+    // Own deque first, then the others'
+    Job* Take(Worker& worker);
+    void WorkerLoop(unsigned int index);
+
+    template<typename F>
+    void Split(JobCounter& counter, uint32_t begin, uint32_t end, uint32_t grain, const F& function);
+};
+
+template<typename F>
+void JobSystem::Store(Job& job, F&& function, JobCounter& counter)
+{
+    using Function = typename std::decay<F>::type;
+    static_assert(sizeof(Function) <= Job::DataSize, "Job captures too large, capture by reference or pointer");
+    static_assert(alignof(Function) <= 16, "Job captures over-aligned");
+
+    new (job.Data) Function(std::forward<F>(function));
+    job.Function = [](void* data)
+    {
+        Function& stored = *(Function*)data;
+        stored();
+        stored.~Function();
+    };
+    job.Counter = &counter;
+}
+
+template<typename F>
+void JobSystem::Run(JobCounter& counter, F&& function)
+{
+    counter.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    Worker* worker = GetCurrentWorker();
+    Job* job = worker ? Allocate(*worker) : nullptr;
+    if (!job)
+    {
+        function();
+        if (worker)
+            worker->Inline.fetch_add(1, std::memory_order_relaxed);
+        Finish(counter);
+        return;
+    }
+
+    Store(*job, std::forward<F>(function), counter);
+    Submit(job);
+}
+
+template<typename F>
+void JobSystem::Run(JobCounter& counter, F&& function, JobCounter& dependency)
+{
+    counter.m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+    // Could wait for longer than the pool takes to come round, so not from the pool
+    Job* job = new Job();
+    job->Heap = true;
+    Store(*job, std::forward<F>(function), counter);
+
+    {
+        // The Finish() bringing it to zero takes the list under the same lock
+        std::lock_guard<std::mutex> lock(dependency.m_Mutex);
+        if (dependency.m_Pending.load() != 0)
+        {
+            dependency.m_Waiting.push_back(job);
+            return;
+        }
+    }
+
+    Submit(job);
+}
+
+template<typename F>
+void JobSystem::Split(JobCounter& counter, uint32_t begin, uint32_t end, uint32_t grain, const F& function)
+{
+    // Halves go to the deque, thieves take the oldest and so the largest
+    while (end - begin > grain)
+    {
+        uint32_t middle = begin + (end - begin) / 2;
+        Run(counter, [this, &counter, middle, end, grain, &function]
+        {
+            Split(counter, middle, end, grain, function);
+        });
+        end = middle;
+    }
+
+    function(begin, end);
+}
+
+template<typename F>
+void JobSystem::ParallelFor(uint32_t begin, uint32_t end, uint32_t grain, const F& function)
+{
+    if (begin >= end)
+        return;
+
+    JobCounter counter;
+    Split(counter, begin, end, grain > 0 ? grain : 1, function);
+    Wait(counter);
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+#include "Profiler.hpp"
+#include "Renderer.h"
+
+#include "vendor/imgui/imgui.h"
+
+Profiler* g_Profiler = nullptr;
+
+Profiler::Profiler()
+:   m_Epoch(std::chrono::steady_clock::now()),
+    m_Current(0),
+    m_FrameIndex(0),
+    m_InFrame(false),
+    m_CpuDepth(0),
+    m_GpuDepth(0),
+    m_FrameCpuZone(0),
+    m_FrameGpuZone(0),
+    m_HistoryHead(0)
+{
+    g_Profiler = this;
+}
+
+Profiler::~Profiler()
+{
+    for (FrameQueries& frame : m_FrameQueries)
+    {
+        if (!frame.Queries.empty())
+        {
+            GLCall(glDeleteQueries((int)frame.Queries.size(), frame.Queries.data()));
+        }
+    }
+
+    if (g_Profiler == this)
+        g_Profiler = nullptr;
+}
+
+uint64_t Profiler::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Epoch).count();
+}
+
+void Profiler::BeginFrame()
+{
+    ASSERT(!m_InFrame);
+
+    FrameQueries& frame = m_FrameQueries[m_Current];
+
+    // The ring came back around before the GPU finished this set
+    if (frame.Pending)
+    {
+        m_Stats.Stalls++;
+        Resolve(frame);
+    }
+
+    frame.Captured.Index = m_FrameIndex;
+    frame.Captured.CpuZones.clear();
+    frame.Captured.GpuZones.clear();
+    frame.CpuStart = Now();
+    frame.QueriesUsed = 0;
+    frame.Zones.clear();
+
+    m_InFrame = true;
+    m_CpuDepth = 0;
+    m_GpuDepth = 0;
+
+    m_FrameCpuZone = BeginCpuZone("Frame");
+    m_FrameGpuZone = BeginGpuZone("Frame");
+}
+
+void Profiler::EndFrame()
+{
+    ASSERT(m_InFrame);
+
+    EndGpuZone(m_FrameGpuZone);
+    EndCpuZone(m_FrameCpuZone);
+
+    m_FrameQueries[m_Current].Pending = true;
+    m_InFrame = false;
+    m_FrameIndex++;
+    m_Current = (m_Current + 1) % FrameLatency;
+
+    // Oldest first, so history stays in frame order
+    for (unsigned int i = 0; i < FrameLatency; i++)
+    {
+        FrameQueries& frame = m_FrameQueries[(m_Current + i) % FrameLatency];
+        if (!frame.Pending)
+            continue;
+
+        if (!IsResolvable(frame))
+            break;
+
+        Resolve(frame);
+    }
+}
+
+unsigned int Profiler::BeginCpuZone(const char* name)
+{
+    std::vector<Zone>& zones = m_FrameQueries[m_Current].Captured.CpuZones;
+    zones.push_back({ name, Now(), 0, m_CpuDepth++ });
+
+    return (unsigned int)zones.size() - 1;
+}
+
+void Profiler::EndCpuZone(unsigned int zone)
+{
+    m_FrameQueries[m_Current].Captured.CpuZones[zone].End = Now();
+    m_CpuDepth--;
+}
+
+unsigned int Profiler::BeginGpuZone(const char* name)
+{
+    FrameQueries& frame = m_FrameQueries[m_Current];
+    unsigned int query = IssueTimestamp(frame);
+    frame.Zones.push_back({ name, query, query, m_GpuDepth++ });
+
+    return (unsigned int)frame.Zones.size() - 1;
+}
+
+void Profiler::EndGpuZone(unsigned int zone)
+{
+    FrameQueries& frame = m_FrameQueries[m_Current];
+    frame.Zones[zone].EndQuery = IssueTimestamp(frame);
+    m_GpuDepth--;
+}
+
+unsigned int Profiler::IssueTimestamp(FrameQueries& frame)
+{
+    if (frame.QueriesUsed == frame.Queries.size())
+    {
+        unsigned int query;
+        GLCall(glGenQueries(1, &query));
+        frame.Queries.push_back(query);
+    }
+
+    unsigned int index = frame.QueriesUsed++;
+    GLCall(glQueryCounter(frame.Queries[index], GL_TIMESTAMP));
+
+    return index;
+}
+
+bool Profiler::IsResolvable(const FrameQueries& frame) const
+{
+    // Queries complete in order, the last one issued stands for all of them
+    int available = 0;
+    GLCall(glGetQueryObjectiv(frame.Queries[frame.QueriesUsed - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+
+    return available != 0;
+}
+
+void Profiler::Resolve(FrameQueries& frame)
+{
+    std::vector<uint64_t> timestamps(frame.QueriesUsed);
+    for (unsigned int i = 0; i < frame.QueriesUsed; i++)
+    {
+        GLCall(glGetQueryObjectui64v(frame.Queries[i], GL_QUERY_RESULT, &timestamps[i]));
+    }
+
+    // Query 0 is the frame's own begin, issued alongside CpuStart
+    uint64_t gpuStart = timestamps[0];
+    for (const GpuZone& zone : frame.Zones)
+    {
+        frame.Captured.GpuZones.push_back({
+            zone.Name,
+            frame.CpuStart + (timestamps[zone.BeginQuery] - gpuStart),
+            frame.CpuStart + (timestamps[zone.EndQuery] - gpuStart),
+            zone.Depth
+        });
+    }
+
+    frame.Pending = false;
+
+    RecordHistory(frame.Captured);
+
+    m_Frames.push_back(frame.Captured);
+    if (m_Frames.size() > HistoryLength)
+        m_Frames.pop_front();
+}
+
+void Profiler::RecordHistory(const Frame& frame)
+{
+    for (auto& entry : m_History)
+    {
+        entry.second.CpuMs[m_HistoryHead] = 0.0f;
+        entry.second.GpuMs[m_HistoryHead] = 0.0f;
+    }
+
+    for (const Zone& zone : frame.CpuZones)
+        m_History[zone.Name].CpuMs[m_HistoryHead] += (zone.End - zone.Start) / 1e6f;
+
+    for (const Zone& zone : frame.GpuZones)
+        m_History[zone.Name].GpuMs[m_HistoryHead] += (zone.End - zone.Start) / 1e6f;
+
+    m_HistoryHead = (m_HistoryHead + 1) % HistoryLength;
+}
+
+static void PlotHistory(const char* id, const char* label, const float* samples, unsigned int head)
+{
+    float average = 0.0f, peak = 0.0f;
+    for (unsigned int i = 0; i < Profiler::HistoryLength; i++)
+    {
+        average += samples[i];
+        peak = std::max(peak, samples[i]);
+    }
+    average /= Profiler::HistoryLength;
+
+    char overlay[64];
+    snprintf(overlay, sizeof(overlay), "%s avg %.3f max %.3f ms", label, average, peak);
+
+    // Starting at head plots the oldest sample first
+    ImGui::PlotLines(id, samples, Profiler::HistoryLength, head, overlay, 0.0f, peak * 1.2f + 0.001f, ImVec2(0, 40));
+}
+
+void Profiler::DrawImGui()
+{
+    ImGui::Begin("Profiler");
+
+    ImGui::Text("Frames kept: %u, GPU readback stalls: %u", (unsigned int)m_Frames.size(), m_Stats.Stalls);
+
+    if (ImGui::Button("Save trace"))
+    {
+        if (WriteChromeTrace("profile.json"))
+            std::cout << "[Profiler] Wrote " << m_Frames.size() << " frames to profile.json" << '\n';
+    }
+
+    for (const auto& entry : m_History)
+    {
+        ImGui::PushID(entry.first.c_str());
+        ImGui::TextUnformatted(entry.first.c_str());
+        PlotHistory("##cpu", "CPU", entry.second.CpuMs, m_HistoryHead);
+        PlotHistory("##gpu", "GPU", entry.second.GpuMs, m_HistoryHead);
+        ImGui::PopID();
+    }
+
+    ImGui::End();
+}
+
+static void WriteTraceString(std::ofstream& stream, const char* text)
+{
+    stream << '"';
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            stream << '\\';
+        stream << *c;
+    }
+    stream << '"';
+}
+
+static void WriteTraceZones(std::ofstream& stream, const std::vector<Profiler::Zone>& zones, int thread)
+{
+    for (const Profiler::Zone& zone : zones)
+    {
+        stream << ",\n{\"name\":";
+        WriteTraceString(stream, zone.Name);
+        // trace_event times are in microseconds
+        stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << thread
+               << ",\"ts\":" << zone.Start / 1000.0
+               << ",\"dur\":" << (zone.End - zone.Start) / 1000.0 << "}";
+    }
+}
+
+bool Profiler::WriteChromeTrace(const std::string& filepath) const
+{
+    std::ofstream stream(filepath);
+    if (!stream)
+    {
+        std::cout << "[Profiler] Could not open " << filepath << '\n';
+        return false;
+    }
+
+    stream.precision(15);
+    stream << "{\"traceEvents\":[\n"
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+           << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+    for (const Frame& frame : m_Frames)
+    {
+        WriteTraceZones(stream, frame.CpuZones, 1);
+        WriteTraceZones(stream, frame.GpuZones, 2);
+    }
+
+    stream << "\n]}\n";
+
+    return (bool)stream;
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+/*
+ PROFILER_ENABLED 0 compiles every PROFILE_* zone away.
+ */
+#ifndef PROFILER_ENABLED
+    #define PROFILER_ENABLED 1
+#endif
+
+/*
+ Per-frame CPU and GPU zones.
+
+ CPU zones read steady_clock. GPU zones put a GL_TIMESTAMP query
+ (glQueryCounter) on each end, so unlike GL_TIME_ELAPSED they can nest.
+ Every frame has its own set of query objects in a ring of FrameLatency
+ sets, and a set is only read back once its last query is available, so
+ the profiler never waits on the GPU unless the ring wraps around onto a
+ frame that is still in flight (counted as a stall).
+
+ GPU times are placed on the CPU timeline relative to the timestamp
+ taken at BeginFrame(), so the GPU track starts where the frame's CPU
+ track does rather than where the GPU really started it.
+
+ Frames are kept once their GPU zones are resolved, up to HistoryLength
+ of them: DrawImGui() plots each zone's history and WriteChromeTrace()
+ dumps them for chrome://tracing or Perfetto.
+
+ Zones are recorded from the render thread only, between BeginFrame()
+ and EndFrame(), and only while a Profiler exists.
+ */
+class Profiler
+{
+public:
+    // Frames between issuing a GPU query and reading it back
+    static const unsigned int FrameLatency = 4;
+    static const unsigned int HistoryLength = 240;
+
+    struct Zone
+    {
+        const char* Name;
+        uint64_t Start; // ns since the profiler was created
+        uint64_t End;
+        unsigned int Depth;
+    };
+
+    struct Frame
+    {
+        uint64_t Index;
+        std::vector<Zone> CpuZones;
+        std::vector<Zone> GpuZones;
+    };
+
+    struct Stats
+    {
+        unsigned int Stalls = 0; // Frames whose queries had to be waited on
+    };
+
+private:
+    struct GpuZone
+    {
+        const char* Name;
+        unsigned int BeginQuery;
+        unsigned int EndQuery;
+        unsigned int Depth;
+    };
+
+    struct FrameQueries
+    {
+        Frame Captured;
+        uint64_t CpuStart;
+        std::vector<unsigned int> Queries; // Grows to the busiest frame, never shrinks
+        unsigned int QueriesUsed = 0;
+        std::vector<GpuZone> Zones;
+        bool Pending = false;
+    };
+
+    // One sample per resolved frame, summed over zones sharing a name
+    struct ZoneHistory
+    {
+        float CpuMs[HistoryLength] = {};
+        float GpuMs[HistoryLength] = {};
+    };
+
+    std::chrono::steady_clock::time_point m_Epoch;
+
+    FrameQueries m_FrameQueries[FrameLatency];
+    unsigned int m_Current;
+    uint64_t m_FrameIndex;
+    bool m_InFrame;
+
+    unsigned int m_CpuDepth;
+    unsigned int m_GpuDepth;
+    unsigned int m_FrameCpuZone;
+    unsigned int m_FrameGpuZone;
+
+    std::deque<Frame> m_Frames;
+    std::map<std::string, ZoneHistory> m_History;
+    unsigned int m_HistoryHead;
+
+    Stats m_Stats;
+
+public:
+    // Needs a current GL context, registers itself as g_Profiler
+    Profiler();
+    ~Profiler();
+
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    // Also open a "Frame" zone on both timelines
+    void BeginFrame();
+    void EndFrame();
+
+    // Return the zone's index in the current frame, for the matching End
+    unsigned int BeginCpuZone(const char* name);
+    void EndCpuZone(unsigned int zone);
+    unsigned int BeginGpuZone(const char* name);
+    void EndGpuZone(unsigned int zone);
+
+    void DrawImGui();
+    // trace_event JSON of every kept frame, CPU and GPU as two threads
+    bool WriteChromeTrace(const std::string& filepath) const;
+
+    inline bool IsInFrame() const { return m_InFrame; }
+    inline const std::deque<Frame>& GetFrames() const { return m_Frames; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    uint64_t Now() const;
+    unsigned int IssueTimestamp(FrameQueries& frame);
+    bool IsResolvable(const FrameQueries& frame) const;
+    void Resolve(FrameQueries& frame);
+    void RecordHistory(const Frame& frame);
+};
+
+extern Profiler* g_Profiler;
+
+class ProfileCpuZone
+{
+private:
+    unsigned int m_Zone;
+    bool m_Active;
+
+public:
+    ProfileCpuZone(const char* name)
+    : m_Zone(0), m_Active(g_Profiler && g_Profiler->IsInFrame())
+    {
+        if (m_Active)
+            m_Zone = g_Profiler->BeginCpuZone(name);
+    }
+
+    ~ProfileCpuZone()
+    {
+        if (m_Active)
+            g_Profiler->EndCpuZone(m_Zone);
+    }
+};
+
+class ProfileGpuZone
+{
+private:
+    unsigned int m_Zone;
+    bool m_Active;
+
+public:
+    ProfileGpuZone(const char* name)
+    : m_Zone(0), m_Active(g_Profiler && g_Profiler->IsInFrame())
+    {
+        if (m_Active)
+            m_Zone = g_Profiler->BeginGpuZone(name);
+    }
+
+    ~ProfileGpuZone()
+    {
+        if (m_Active)
+            g_Profiler->EndGpuZone(m_Zone);
+    }
+};
+
+#define PROFILE_ZONE_NAME_(kind, id) profile##kind##id
+#define PROFILE_ZONE_NAME(kind, id) PROFILE_ZONE_NAME_(kind, id)
+
+// `name` must outlive the profiler, i.e. a string literal
+#if PROFILER_ENABLED
+    #define PROFILE_CPU_ZONE(name) ProfileCpuZone PROFILE_ZONE_NAME(CpuZone, __COUNTER__)(name)
+    #define PROFILE_GPU_ZONE(name) ProfileGpuZone PROFILE_ZONE_NAME(GpuZone, __COUNTER__)(name)
+#else
+    #define PROFILE_CPU_ZONE(name)
+    #define PROFILE_GPU_ZONE(name)
+#endif
+
+// Both timelines under one name
+#define PROFILE_ZONE(name) PROFILE_CPU_ZONE(name); PROFILE_GPU_ZONE(name)
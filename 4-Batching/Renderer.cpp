@@ -6,8 +6,11 @@
 //
 
 #include <iostream>
+#include <chrono>
 
 #include "Renderer.h"
+#include "Texture.hpp"
+#include "Profiler.hpp"
 
 
 void GLClearError()
@@ -27,24 +30,292 @@ bool GLLogCall(const char* function, const char* file, int line)
         hasError = true;
         
         std::cout << "[OpenGL Error](" << error << "): " <<
-        function << " in " << file << ", line: " << line <<
-        std::endl;
+        function << " in " << file << ", line: " << line << '\n';
     }
     
     return !hasError;
 }
 
+GLCallSite* g_GLCallSite = nullptr;
+bool g_GLDebugOutput = false;
+
+static GLCallSite s_UnknownCallSite = { "<outside GLCall>", "", 0 };
+static GLCallSite* s_ErrorSites = nullptr;
+
+// Every site logs its first few errors, then at most one summary a second
+static const unsigned int ERRORS_LOGGED_PER_SITE = 3;
+static const double ERROR_REPORT_INTERVAL = 1.0;
+
+static void ReportError(GLCallSite* site, unsigned int error, const char* message)
+{
+    if (!site)
+        site = &s_UnknownCallSite;
+    
+    if (site->errors++ == 0)
+    {
+        site->nextWithErrors = s_ErrorSites;
+        s_ErrorSites = site;
+    }
+    
+    double now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (site->errors > ERRORS_LOGGED_PER_SITE && now - site->lastReport < ERROR_REPORT_INTERVAL)
+    {
+        site->suppressed++;
+        return;
+    }
+    
+    std::cout << "[OpenGL Error](" << error << "): " << site->function <<
+    " in " << site->file << ", line: " << site->line;
+    if (site->suppressed)
+        std::cout << " (" << site->suppressed << " more since last report)";
+    std::cout << '\n';
+    if (message)
+        std::cout << message << '\n';
+    
+    site->suppressed = 0;
+    site->lastReport = now;
+}
+
+void GLPollErrors()
+{
+    while (GLenum error = glGetError())
+        ReportError(g_GLCallSite, error, nullptr);
+}
+
+static void GLAPIENTRY DebugMessageCallback(GLenum, GLenum type, GLuint id, GLenum,
+                                            GLsizei, const GLchar* message, const void*)
+{
+    if (type == GL_DEBUG_TYPE_ERROR)
+        ReportError(g_GLCallSite, id, message);
+}
+
+bool GLEnableDebugOutput()
+{
+    if (!GLAD_GL_VERSION_4_3 || !glDebugMessageCallback)
+        return false;
+    
+    glEnable(GL_DEBUG_OUTPUT);
+    // Synchronous, so the callback runs inside the GLCall that caused it
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(DebugMessageCallback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+    glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+    
+    g_GLDebugOutput = true;
+    return true;
+}
+
+GLCallSite* GLGetErrorSites()
+{
+    return s_ErrorSites;
+}
+
+// Nothing is ever bound as ~0, so it forces the next bind through
+static const unsigned int UNKNOWN_BINDING = ~0u;
+
+Renderer::Renderer()
+{
+    InvalidateState();
+}
+
 void Renderer::Clear() const
 {
     GLCall(glClear(GL_COLOR_BUFFER_BIT));
 }
 
-void Renderer::Draw(const VertexArray &va, const IndexBuffer &ib, const Shader &shader) const
+void Renderer::Draw(const VertexArray &va, const IndexBuffer &ib, const Shader &shader)
+{
+    Draw(va, ib, shader, ib.GetCount());
+}
+
+void Renderer::Draw(const VertexArray &va, const IndexBuffer &ib, const Shader &shader, unsigned int count,
+                    int baseVertex)
+{
+    BindShader(shader);
+    BindVertexArray(va);
+    BindIndexBuffer(ib);
+    
+    if (baseVertex)
+    {
+        GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr, baseVertex));
+    }
+    else
+    {
+        GLCall(glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, nullptr));
+    }
+    m_Stats.DrawCalls++;
+}
+
+void Renderer::DrawInstanced(const VertexArray &va, const IndexBuffer &ib, const Shader &shader, unsigned int instanceCount)
+{
+    BindShader(shader);
+    BindVertexArray(va);
+    BindIndexBuffer(ib);
+    
+    GLCall(glDrawElementsInstanced(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr, instanceCount));
+    m_Stats.DrawCalls++;
+}
+
+void Renderer::BindShader(const Shader &shader)
+{
+    if (m_Program == shader.GetRendererID())
+    {
+        m_Stats.StateChangesSkipped++;
+        return;
+    }
+    
+    m_Program = shader.GetRendererID();
+    GLCall(glUseProgram(m_Program));
+    m_Stats.StateChanges++;
+}
+
+void Renderer::BindVertexArray(const VertexArray &va)
 {
-    shader.Bind();
-    va.Bind();
-    ib.Bind();
+    if (m_VertexArray == va.GetRendererID())
+    {
+        m_Stats.StateChangesSkipped++;
+        return;
+    }
+    
+    m_VertexArray = va.GetRendererID();
+    GLCall(glBindVertexArray(m_VertexArray));
+    m_Stats.StateChanges++;
+}
+
+void Renderer::BindIndexBuffer(const IndexBuffer &ib)
+{
+    auto bound = m_ElementBuffers.find(m_VertexArray);
+    if (m_VertexArray != UNKNOWN_BINDING && bound != m_ElementBuffers.end() &&
+        bound->second == ib.GetRendererID())
+    {
+        m_Stats.StateChangesSkipped++;
+        return;
+    }
+    
+    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ib.GetRendererID()));
+    if (m_VertexArray != UNKNOWN_BINDING)
+        m_ElementBuffers[m_VertexArray] = ib.GetRendererID();
+    m_Stats.StateChanges++;
+}
+
+void Renderer::BindTexture(const Texture &texture, unsigned int slot)
+{
+    ASSERT(slot < MaxTextureUnits);
+    
+    if (m_TextureUnits[slot] == texture.GetRendererID())
+    {
+        m_Stats.StateChangesSkipped++;
+        return;
+    }
+    
+    if (m_ActiveTextureUnit != slot)
+    {
+        m_ActiveTextureUnit = slot;
+        GLCall(glActiveTexture(GL_TEXTURE0 + slot));
+        m_Stats.StateChanges++;
+    }
+    
+    m_TextureUnits[slot] = texture.GetRendererID();
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_TextureUnits[slot]));
+    m_Stats.StateChanges++;
+}
+
+uint64_t Renderer::MakeSortKey(unsigned char layer, unsigned int shader, unsigned int texture,
+                               unsigned int vertexArray, float depth)
+{
+    // GL names are small integers, 12 bits keep them apart in practice and
+    // a collision only costs an extra state change, never a wrong draw
+    depth = depth < 0.0f ? 0.0f : (depth > 1.0f ? 1.0f : depth);
+    
+    return ((uint64_t)layer                  << 56) |
+           ((uint64_t)(shader      & 0xfff) << 44) |
+           ((uint64_t)(texture     & 0xfff) << 32) |
+           ((uint64_t)(vertexArray & 0xfff) << 20) |
+           (uint64_t)(depth * 0xfffff);
+}
+
+void Renderer::Submit(const VertexArray &va, const IndexBuffer &ib, const Shader &shader,
+                      const Texture* texture, const glm::mat4& mvp,
+                      unsigned char layer, float depth)
+{
+    uint64_t key = MakeSortKey(layer, shader.GetRendererID(),
+                               texture ? texture->GetRendererID() : 0,
+                               va.GetRendererID(), depth);
+    
+    m_SortEntries.push_back({ key, (uint32_t)m_Commands.size() });
+    m_Commands.push_back({ &va, &ib, &shader, texture, mvp });
+}
+
+// LSD radix sort, one pass per key byte. Passes where every key has the
+// same byte (unused layers, a single shader...) are skipped.
+static void RadixSort(std::vector<Renderer::SortEntry>& entries, std::vector<Renderer::SortEntry>& scratch)
+{
+    scratch.resize(entries.size());
+    
+    Renderer::SortEntry* src = entries.data();
+    Renderer::SortEntry* dst = scratch.data();
+    
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        size_t counts[256] = {};
+        for (size_t i = 0; i < entries.size(); i++)
+            counts[(src[i].key >> shift) & 0xff]++;
+        
+        if (counts[(src[0].key >> shift) & 0xff] == entries.size())
+            continue;
+        
+        size_t offset = 0;
+        for (size_t& count : counts)
+        {
+            size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        
+        for (size_t i = 0; i < entries.size(); i++)
+            dst[counts[(src[i].key >> shift) & 0xff]++] = src[i];
+        
+        std::swap(src, dst);
+    }
+    
+    if (src != entries.data())
+        entries.swap(scratch);
+}
+
+void Renderer::Flush()
+{
+    if (m_Commands.empty())
+        return;
+    
+    PROFILE_ZONE("Queue flush");
+    
+    RadixSort(m_SortEntries, m_SortScratch);
+    
+    for (const SortEntry& entry : m_SortEntries)
+    {
+        const DrawCommand& command = m_Commands[entry.command];
+        
+        BindShader(*command.shader);
+        if (command.texture)
+            BindTexture(*command.texture, 0);
+        
+        command.shader->SetUniformMat4f(command.shader->GetMVPUniform(), command.mvp);
+        Draw(*command.va, *command.ib, *command.shader);
+    }
+    
+    m_Commands.clear();
+    m_SortEntries.clear();
+}
+
+void Renderer::InvalidateState()
+{
+    m_Program = UNKNOWN_BINDING;
+    m_VertexArray = UNKNOWN_BINDING;
+    m_ActiveTextureUnit = UNKNOWN_BINDING;
+    
+    for (unsigned int i = 0; i < MaxTextureUnits; i++)
+        m_TextureUnits[i] = UNKNOWN_BINDING;
     
-    GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
-   
+    // IndexBuffer::Bind outside the renderer rebinds the element buffer of whatever VAO was bound
+    m_ElementBuffers.clear();
 }
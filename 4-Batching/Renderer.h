@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
 #include <glad/glad.h>
 
 #include "VertexArray.hpp"
@@ -8,18 +12,176 @@
 
 
 #define ASSERT(x) if (!(x)) __builtin_trap();
-#define GLCall(x) GLClearError();\
+
+/*
+ GLCALL_MODE picks what every GLCall costs:
+   0  the bare call (default without DEBUG)
+   1  glGetError before and after the call, traps on error (default with DEBUG)
+   2  KHR_debug: the driver reports errors through glDebugMessageCallback and
+      GLCall only records its call site, so errors are counted per site and
+      their logging is rate limited. Needs GLEnableDebugOutput() after the
+      context is created, without GL 4.3 it falls back to glGetError polling.
+ All three stay available by name, e.g. for benchmarks.
+ */
+#ifndef GLCALL_MODE
+    #ifdef DEBUG
+        #define GLCALL_MODE 1
+    #else
+        #define GLCALL_MODE 0
+    #endif
+#endif
+
+#define GLCALL_BARE(x) x
+
+// `name` is #x taken before x is macro expanded (glad turns glFoo into glad_glFoo)
+#define GLCALL_GET_ERROR_(x, name) GLClearError();\
 x;\
-ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+ASSERT(GLLogCall(name, __FILE__, __LINE__))
+#define GLCALL_GET_ERROR(x) GLCALL_GET_ERROR_(x, #x)
+
+#define GLCALL_SITE_NAME_(id) s_GLCallSite##id
+#define GLCALL_SITE_NAME(id) GLCALL_SITE_NAME_(id)
+#define GLCALL_DEBUG_OUTPUT_(x, name, site) static GLCallSite site { name, __FILE__, __LINE__ };\
+GLBeginCall(&site);\
+x;\
+GLEndCall()
+#define GLCALL_DEBUG_OUTPUT(x) GLCALL_DEBUG_OUTPUT_(x, #x, GLCALL_SITE_NAME(__COUNTER__))
+
+#if GLCALL_MODE == 0
+    #define GLCall(x) GLCALL_BARE(x)
+#elif GLCALL_MODE == 1
+    #define GLCall(x) GLCALL_GET_ERROR_(x, #x)
+#else
+    #define GLCall(x) GLCALL_DEBUG_OUTPUT_(x, #x, GLCALL_SITE_NAME(__COUNTER__))
+#endif
 
 void GLClearError();
 bool GLLogCall(const char* function, const char* file, int line);
 
+struct GLCallSite
+{
+    const char* function;
+    const char* file;
+    int line;
+    
+    unsigned int errors = 0;
+    unsigned int suppressed = 0;
+    double lastReport = 0.0;
+    GLCallSite* nextWithErrors = nullptr;
+};
 
+// Render thread only, like every other GL call
+extern GLCallSite* g_GLCallSite;
+extern bool g_GLDebugOutput;
+
+void GLPollErrors();
+bool GLEnableDebugOutput();
+// Sites that reported at least one error, most recent first
+GLCallSite* GLGetErrorSites();
+
+inline void GLBeginCall(GLCallSite* site)
+{
+    g_GLCallSite = site;
+    if (!g_GLDebugOutput)
+        GLClearError();
+}
+
+inline void GLEndCall()
+{
+    if (!g_GLDebugOutput)
+        GLPollErrors();
+    g_GLCallSite = nullptr;
+}
+
+class Texture;
+
+/*
+ Shadows the program, vertex array, element buffer (per vertex array,
+ since the VAO captures it), active texture unit and per-unit texture
+ bindings, so a bind that would not change anything is never issued.
+ 
+ The shadow is only right while every bind goes through the Renderer.
+ Call InvalidateState() after code that binds on its own, e.g. once a
+ frame after ImGui has rendered, or after creating or deleting GL objects.
+ 
+ Submit() defers a draw instead: the command is recorded with a 64-bit
+ sort key and Flush() executes the queue in key order, so draws that
+ share a shader, texture or vertex array run back to back whatever
+ order they were submitted in.
+ 
+     63      56 55     44 43      32 31     20 19      0
+     [ layer ] [ shader ] [ texture ] [  vao  ] [ depth ]
+ */
 class Renderer
 {
+public:
+    static const unsigned int MaxTextureUnits = 32;
+    
+    struct Stats
+    {
+        unsigned int DrawCalls = 0;
+        unsigned int StateChanges = 0;
+        unsigned int StateChangesSkipped = 0;
+    };
+    
+    struct DrawCommand
+    {
+        const VertexArray* va;
+        const IndexBuffer* ib;
+        const Shader*      shader;
+        const Texture*     texture;
+        glm::mat4          mvp;
+    };
+    
+    // What actually gets sorted, the command itself stays where it was recorded
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t command;
+    };
+    
 private:
+    unsigned int m_Program;
+    unsigned int m_VertexArray;
+    unsigned int m_ActiveTextureUnit;
+    unsigned int m_TextureUnits[MaxTextureUnits];
+    std::unordered_map<unsigned int, unsigned int> m_ElementBuffers;
+    
+    std::vector<DrawCommand> m_Commands;
+    std::vector<SortEntry>   m_SortEntries;
+    std::vector<SortEntry>   m_SortScratch;
+    
+    Stats m_Stats;
+    
 public:
+    Renderer();
+    
     void Clear() const;
-    void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
+    void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader);
+    // Draws only the first `count` indices of `ib`, each offset by `baseVertex`
+    void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int count,
+              int baseVertex = 0);
+    // One call for `instanceCount` copies of the mesh, per-instance data comes from divisor attributes
+    void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount);
+    
+    void BindShader(const Shader& shader);
+    void BindVertexArray(const VertexArray& va);
+    // Binds into the element buffer slot of the current vertex array
+    void BindIndexBuffer(const IndexBuffer& ib);
+    void BindTexture(const Texture& texture, unsigned int slot = 0);
+    
+    // Queued until Flush(), `mvp` is uploaded to the shader's u_MVP.
+    // Lower layers draw first, depth in [0, 1] only orders within equal state.
+    void Submit(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+                const Texture* texture, const glm::mat4& mvp,
+                unsigned char layer = 0, float depth = 0.0f);
+    void Flush();
+    
+    static uint64_t MakeSortKey(unsigned char layer, unsigned int shader, unsigned int texture,
+                                unsigned int vertexArray, float depth);
+    
+    void InvalidateState();
+    
+    inline const Stats& GetStats() const { return m_Stats; }
+    inline void ResetStats() { m_Stats = Stats(); }
 };
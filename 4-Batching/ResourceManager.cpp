@@ -0,0 +1,193 @@
+#include <algorithm>
+
+#include "ResourceManager.hpp"
+#include "TextureLoader.hpp"
+#include "Renderer.h"
+
+// Joined the way ShaderWatcher tells permutations apart, file and defines
+static std::string shaderKey(const std::string& filepath, const std::vector<std::string>& defines)
+{
+    std::string key = filepath;
+    for (const std::string& define : defines)
+    {
+        key += '\n';
+        key += define;
+    }
+    return key;
+}
+
+ResourceManager::ResourceManager(TextureLoader* loader, uint64_t textureBudget)
+:   m_Loader(loader),
+    m_TextureBudget(textureBudget),
+    m_Frame(1)
+{
+}
+
+std::shared_ptr<Texture> ResourceManager::CreateTexture(const std::string& filepath)
+{
+    if (m_Loader)
+        return m_Loader->Load(filepath);
+
+    return std::make_shared<Texture>(filepath);
+}
+
+TextureHandle ResourceManager::LoadTexture(const std::string& filepath)
+{
+    TextureHandle handle = m_Textures.Find(filepath);
+    if (handle.IsValid())
+    {
+        Retain(handle);
+        m_Stats.Hits++;
+    }
+    else
+        handle = m_Textures.Add(CreateTexture(filepath), filepath);
+
+    // Not yet drawn, but not stale either
+    m_Textures.Lookup(handle)->LastUsed = m_Frame;
+    return handle;
+}
+
+ShaderHandle ResourceManager::LoadShader(const std::string& filepath, const std::vector<std::string>& defines)
+{
+    std::string key = shaderKey(filepath, defines);
+
+    ShaderHandle handle = m_Shaders.Find(key);
+    if (handle.IsValid())
+    {
+        Retain(handle);
+        m_Stats.Hits++;
+        return handle;
+    }
+
+    return m_Shaders.Add(std::make_shared<Shader>(filepath, defines), key);
+}
+
+VertexBufferHandle ResourceManager::CreateVertexBuffer(const void* data, unsigned int size, BufferUsage usage)
+{
+    return m_VertexBuffers.Add(std::make_shared<VertexBuffer>(data, size, usage), std::string());
+}
+
+IndexBufferHandle ResourceManager::CreateIndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage)
+{
+    return m_IndexBuffers.Add(std::make_shared<IndexBuffer>(data, count, usage), std::string());
+}
+
+void ResourceManager::Update()
+{
+    Stats stats;
+
+    // Sizes change behind our back: streamed textures replace their placeholder, buffers grow
+    uint64_t residentBytes = 0;
+    for (uint32_t i = 0; i < (uint32_t)m_Textures.GetSlots().size(); i++)
+    {
+        auto& slot = m_Textures.GetSlots()[i];
+        if (!slot.Occupied)
+            continue;
+
+        // Cached while there was a budget, which has since been lifted
+        if (slot.RefCount == 0 && m_TextureBudget == 0)
+        {
+            m_Textures.Remove(i);
+            continue;
+        }
+
+        slot.Bytes = slot.Resource ? slot.Resource->GetMemorySize() : 0;
+        residentBytes += slot.Bytes;
+    }
+
+    if (m_TextureBudget > 0 && residentBytes > m_TextureBudget)
+        EvictTextures(residentBytes);
+
+    for (const auto& slot : m_Textures.GetSlots())
+    {
+        if (!slot.Occupied)
+            continue;
+
+        if (!slot.Resource)
+            stats.EvictedTextures++;
+        else
+        {
+            stats.Textures++;
+            stats.TextureBytes += slot.Bytes;
+            if (slot.RefCount == 0)
+                stats.CachedTextures++;
+        }
+    }
+
+    for (auto& slot : m_Shaders.GetSlots())
+    {
+        if (!slot.Occupied)
+            continue;
+
+        // Only changes when ShaderWatcher swaps the program, cheap to ask anyway
+        int length = 0;
+        GLCall(glGetProgramiv(slot.Resource->GetRendererID(), GL_PROGRAM_BINARY_LENGTH, &length));
+        slot.Bytes = (uint64_t)length;
+
+        stats.Shaders++;
+        stats.ShaderBytes += slot.Bytes;
+    }
+
+    for (auto& slot : m_VertexBuffers.GetSlots())
+    {
+        if (!slot.Occupied)
+            continue;
+
+        slot.Bytes = slot.Resource->GetCapacity();
+        stats.Buffers++;
+        stats.BufferBytes += slot.Bytes;
+    }
+
+    for (auto& slot : m_IndexBuffers.GetSlots())
+    {
+        if (!slot.Occupied)
+            continue;
+
+        slot.Bytes = (uint64_t)slot.Resource->GetCapacity() * sizeof(unsigned int);
+        stats.Buffers++;
+        stats.BufferBytes += slot.Bytes;
+    }
+
+    stats.Hits = m_Stats.Hits;
+    stats.Evictions = m_Stats.Evictions;
+    stats.Reloads = m_Stats.Reloads;
+    m_Stats = stats;
+    m_Frame++;
+}
+
+void ResourceManager::EvictTextures(uint64_t& residentBytes)
+{
+    std::vector<ResourcePool<Texture>::Slot>& slots = m_Textures.GetSlots();
+
+    // Anything drawn this frame or the last may still be bound or referenced by a pending batch
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < (uint32_t)slots.size(); i++)
+    {
+        if (slots[i].Occupied && slots[i].Resource && slots[i].LastUsed + 1 < m_Frame)
+            candidates.push_back(i);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b)
+    {
+        if ((slots[a].RefCount == 0) != (slots[b].RefCount == 0))
+            return slots[a].RefCount == 0;
+        return slots[a].LastUsed < slots[b].LastUsed;
+    });
+
+    for (uint32_t index : candidates)
+    {
+        if (residentBytes <= m_TextureBudget)
+            break;
+
+        ResourcePool<Texture>::Slot& slot = slots[index];
+        residentBytes -= slot.Bytes;
+        slot.Bytes = 0;
+        m_Stats.Evictions++;
+
+        // Unreferenced, nobody can ask for it again by handle
+        if (slot.RefCount == 0)
+            m_Textures.Remove(index);
+        else
+            slot.Resource.reset();
+    }
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "BufferUsage.hpp"
+#include "IndexBuffer.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "VertexBuffer.h"
+
+class TextureLoader;
+
+// Slot in a pool plus the slot's generation when it was handed out. Freeing
+// a slot bumps its generation, so a stale handle finds nothing instead of
+// whatever reused the slot
+template<typename T>
+struct ResourceHandle
+{
+    uint32_t Index = 0xFFFFFFFF;
+    uint32_t Generation = 0;
+
+    inline bool IsValid() const { return Index != 0xFFFFFFFF; }
+    inline bool operator==(const ResourceHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+    inline bool operator!=(const ResourceHandle& other) const { return !(*this == other); }
+};
+
+using TextureHandle = ResourceHandle<Texture>;
+using ShaderHandle = ResourceHandle<Shader>;
+using VertexBufferHandle = ResourceHandle<VertexBuffer>;
+using IndexBufferHandle = ResourceHandle<IndexBuffer>;
+
+/*
+ Slots of one resource type in a single vector, reused through a free
+ list so indices stay small and the bookkeeping stays in one block of
+ memory. Named resources are also indexed by key for deduplication.
+ */
+template<typename T>
+class ResourcePool
+{
+public:
+    struct Slot
+    {
+        std::shared_ptr<T> Resource;   // Null while the slot is free or the resource evicted
+        std::string Key;               // Empty for resources without a file
+        uint32_t Generation = 1;       // Starts at 1, a default handle never matches
+        uint32_t RefCount = 0;
+        uint64_t Bytes = 0;            // Video memory, as of the last ResourceManager::Update()
+        uint64_t LastUsed = 0;         // Frame of the last Get()
+        bool Occupied = false;
+    };
+
+private:
+    std::vector<Slot> m_Slots;
+    std::vector<uint32_t> m_Free;
+    std::unordered_map<std::string, uint32_t> m_ByKey;
+
+public:
+    ResourceHandle<T> Add(std::shared_ptr<T> resource, const std::string& key)
+    {
+        uint32_t index;
+        if (!m_Free.empty())
+        {
+            index = m_Free.back();
+            m_Free.pop_back();
+        }
+        else
+        {
+            index = (uint32_t)m_Slots.size();
+            m_Slots.emplace_back();
+        }
+
+        Slot& slot = m_Slots[index];
+        slot.Resource = std::move(resource);
+        slot.Key = key;
+        slot.RefCount = 1;
+        slot.Bytes = 0;
+        slot.LastUsed = 0;
+        slot.Occupied = true;
+
+        if (!key.empty())
+            m_ByKey[key] = index;
+
+        return { index, slot.Generation };
+    }
+
+    void Remove(uint32_t index)
+    {
+        Slot& slot = m_Slots[index];
+        if (!slot.Key.empty())
+            m_ByKey.erase(slot.Key);
+
+        slot.Resource.reset();
+        slot.Key.clear();
+        slot.Generation++;
+        slot.Occupied = false;
+        m_Free.push_back(index);
+    }
+
+    // Null for a stale or default handle
+    Slot* Lookup(ResourceHandle<T> handle)
+    {
+        if (handle.Index >= m_Slots.size())
+            return nullptr;
+
+        Slot& slot = m_Slots[handle.Index];
+        return slot.Occupied && slot.Generation == handle.Generation ? &slot : nullptr;
+    }
+
+    ResourceHandle<T> Find(const std::string& key) const
+    {
+        auto found = m_ByKey.find(key);
+        if (found == m_ByKey.end())
+            return {};
+
+        return { found->second, m_Slots[found->second].Generation };
+    }
+
+    inline std::vector<Slot>& GetSlots() { return m_Slots; }
+};
+
+/*
+ Owns textures, shaders and buffers behind generational handles.
+
+ Loading a path (and, for shaders, a set of defines) that is already
+ loaded returns the same resource with one more reference instead of
+ decoding and uploading it again. Release() drops a reference; shaders
+ and buffers go away with their last one.
+
+ Textures are accounted for in video memory and kept against a budget.
+ Without a budget (0) an unreferenced texture is freed right away. With
+ one, unreferenced textures stay cached for the next LoadTexture() until
+ Update() finds the total over budget: then the least recently used
+ ones go first, unreferenced before referenced, never one used in this
+ or the previous frame. An evicted texture keeps its handle, and the
+ next Get() loads it again. Get() a texture every frame rather than
+ holding on to the pointer, it only stays valid until the next Update().
+
+ With a TextureLoader, textures (and reloads) stream in asynchronously
+ behind its placeholder instead of blocking in LoadTexture() and Get().
+ */
+class ResourceManager
+{
+public:
+    struct Stats
+    {
+        uint64_t TextureBytes = 0;
+        uint64_t ShaderBytes = 0;      // Program binary sizes, the driver's own estimate
+        uint64_t BufferBytes = 0;      // Capacity, not size
+        unsigned int Textures = 0;     // Resident
+        unsigned int CachedTextures = 0; // Resident without references, evicted first
+        unsigned int EvictedTextures = 0; // Referenced but not resident
+        unsigned int Shaders = 0;
+        unsigned int Buffers = 0;
+        unsigned int Hits = 0;         // Loads answered by an existing resource
+        unsigned int Evictions = 0;
+        unsigned int Reloads = 0;      // Evicted textures loaded again by Get()
+    };
+
+private:
+    ResourcePool<Texture> m_Textures;
+    ResourcePool<Shader> m_Shaders;
+    ResourcePool<VertexBuffer> m_VertexBuffers;
+    ResourcePool<IndexBuffer> m_IndexBuffers;
+
+    TextureLoader* m_Loader;
+    uint64_t m_TextureBudget;
+    uint64_t m_Frame;
+    Stats m_Stats;
+
+public:
+    // `textureBudget` in bytes, 0 for none
+    // Shaders unregister from the ShaderWatcher when freed, create the watcher first
+    ResourceManager(TextureLoader* loader = nullptr, uint64_t textureBudget = 0);
+
+    ResourceManager(const ResourceManager&) = delete;
+    ResourceManager& operator=(const ResourceManager&) = delete;
+
+    // Each returns a handle holding one reference, pass it to Release() when done
+    TextureHandle LoadTexture(const std::string& filepath);
+    ShaderHandle LoadShader(const std::string& filepath, const std::vector<std::string>& defines = {});
+    VertexBufferHandle CreateVertexBuffer(const void* data, unsigned int size, BufferUsage usage = BufferUsage::STATIC);
+    IndexBufferHandle CreateIndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage = BufferUsage::STATIC);
+
+    template<typename T>
+    void Retain(ResourceHandle<T> handle);
+    template<typename T>
+    void Release(ResourceHandle<T> handle);
+    // Null for a stale handle. Textures are marked as used and reloaded if evicted
+    template<typename T>
+    T* Get(ResourceHandle<T> handle);
+
+    // Once a frame: counts video memory and evicts textures down to the budget
+    void Update();
+
+    inline void SetTextureBudget(uint64_t bytes) { m_TextureBudget = bytes; }
+    inline uint64_t GetTextureBudget() const { return m_TextureBudget; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    template<typename T>
+    ResourcePool<T>& GetPool();
+
+    std::shared_ptr<Texture> CreateTexture(const std::string& filepath);
+    void EvictTextures(uint64_t& residentBytes);
+};
+
+template<> inline ResourcePool<Texture>& ResourceManager::GetPool() { return m_Textures; }
+template<> inline ResourcePool<Shader>& ResourceManager::GetPool() { return m_Shaders; }
+template<> inline ResourcePool<VertexBuffer>& ResourceManager::GetPool() { return m_VertexBuffers; }
+template<> inline ResourcePool<IndexBuffer>& ResourceManager::GetPool() { return m_IndexBuffers; }
+
+template<typename T>
+void ResourceManager::Retain(ResourceHandle<T> handle)
+{
+    typename ResourcePool<T>::Slot* slot = GetPool<T>().Lookup(handle);
+    if (slot)
+        slot->RefCount++;
+}
+
+template<typename T>
+void ResourceManager::Release(ResourceHandle<T> handle)
+{
+    typename ResourcePool<T>::Slot* slot = GetPool<T>().Lookup(handle);
+    if (!slot || slot->RefCount == 0 || --slot->RefCount > 0)
+        return;
+
+    // Unreferenced textures are worth keeping while there is room for them
+    if (std::is_same<T, Texture>::value && m_TextureBudget > 0 && slot->Resource)
+        return;
+
+    GetPool<T>().Remove(handle.Index);
+}
+
+template<typename T>
+T* ResourceManager::Get(ResourceHandle<T> handle)
+{
+    typename ResourcePool<T>::Slot* slot = GetPool<T>().Lookup(handle);
+    if (!slot)
+        return nullptr;
+
+    if constexpr (std::is_same<T, Texture>::value)
+    {
+        slot->LastUsed = m_Frame;
+        if (!slot->Resource)
+        {
+            slot->Resource = CreateTexture(slot->Key);
+            m_Stats.Reloads++;
+        }
+    }
+
+    return slot->Resource.get();
+}
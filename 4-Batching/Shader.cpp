@@ -1,34 +1,90 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/stat.h>
 
 #include "Shader.hpp"
+#include "ShaderWatcher.hpp"
 #include "Renderer.h"
 
-ShaderProgramSource Shader::Parse(const std::string& filepath)
+static std::string s_CacheDirectory;
+static ShaderCacheStats s_CacheStats;
+
+// Precedes the driver's blob in every cache file
+struct ProgramBinaryHeader
+{
+    char Magic[4];
+    uint32_t Format;
+    uint64_t Key;
+    uint32_t Length;
+};
+
+static const char s_BinaryMagic[4] = { 'P', 'B', 'I', 'N' };
+// Far above any real program binary, anything larger is a corrupt header
+static const uint32_t s_MaxBinaryLength = 64 * 1024 * 1024;
+
+// FNV-1a over every stage and the driver that compiled them
+static uint64_t hashProgram(const ShaderProgramSource& source)
 {
-    std::ifstream stream(filepath);
+    uint64_t hash = 14695981039346656037ull;
+    auto feed = [&hash](const char* data)
+    {
+        for (; data && *data; data++)
+            hash = (hash ^ (uint8_t)*data) * 1099511628211ull;
+        
+        // Keeps "ab" + "c" apart from "a" + "bc"
+        hash = (hash ^ 0xFF) * 1099511628211ull;
+    };
+    
+    const char* renderer;
+    const char* version;
+    GLCall(renderer = (const char*)glGetString(GL_RENDERER));
+    GLCall(version = (const char*)glGetString(GL_VERSION));
     
-    enum class ShaderType
-    { NONE = -1, VERTEX = 0, FRAGMENT = 1 };
+    feed(source.VertexSource.c_str());
+    feed(source.FragmentSource.c_str());
+    feed(source.GeometrySource.c_str());
+    feed(source.ComputeSource.c_str());
+    feed(renderer);
+    feed(version);
+    
+    return hash;
+}
+
+static std::string binaryPath(uint64_t key)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+    return s_CacheDirectory + name;
+}
+
+static bool isBinaryFormatSupported(unsigned int format)
+{
+    int count = 0;
+    GLCall(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &count));
+    if (count == 0)
+        return false;
     
-    std::string      line;
-    std::stringstream ss[2];
-    ShaderType type = ShaderType::NONE;
+    std::vector<int> formats(count);
+    GLCall(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data()));
     
-    while (getline(stream, line))
+    return std::find(formats.begin(), formats.end(), (int)format) != formats.end();
+}
+
+static const char* getStageName(unsigned int type)
+{
+    switch (type)
     {
-        if (line.find("#shader") != std::string::npos)
-        {
-            if (line.find("vertex") != std::string::npos)
-                type = ShaderType::VERTEX;
-            else if (line.find("fragment") != std::string::npos)
-                type = ShaderType::FRAGMENT;
-        }
-        else ss[(int)type] << line << '\n';
+        case GL_VERTEX_SHADER:   return "vertex";
+        case GL_FRAGMENT_SHADER: return "fragment";
+        case GL_GEOMETRY_SHADER: return "geometry";
+        case GL_COMPUTE_SHADER:  return "compute";
+        default:                 return "unknown";
     }
-    
-    return { ss[0].str(), ss[1].str() };
 }
 
 unsigned int Shader::Compile(unsigned int type, const std::string& source)
@@ -47,9 +103,7 @@ unsigned int Shader::Compile(unsigned int type, const std::string& source)
         char* message = (char*)alloca(length * sizeof(char));
         
         glGetShaderInfoLog(id, length, &length, message);
-        std::cout << "Failed to compile " <<
-        (type == GL_VERTEX_SHADER ? "vertex" : "fragment") <<
-        " shader!" << std::endl;
+        std::cout << "Failed to compile " << getStageName(type) << " shader!" << std::endl;
         
         std::cout << message << std::endl;
         
@@ -61,34 +115,213 @@ unsigned int Shader::Compile(unsigned int type, const std::string& source)
     return id;
 }
 
-unsigned int Shader::Create(const std::string& vertexShader, const std::string& fragmentShader)
+unsigned int Shader::Link(const ShaderProgramSource& source)
 {
     unsigned int program = glCreateProgram();
     
-    unsigned int vs = Compile(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = Compile(GL_FRAGMENT_SHADER, fragmentShader);
+    // Compute stands alone, the other stages are used when present
+    std::vector<unsigned int> stages;
+    if (!source.ComputeSource.empty())
+        stages.push_back(Compile(GL_COMPUTE_SHADER, source.ComputeSource));
+    else
+    {
+        stages.push_back(Compile(GL_VERTEX_SHADER, source.VertexSource));
+        if (!source.GeometrySource.empty())
+            stages.push_back(Compile(GL_GEOMETRY_SHADER, source.GeometrySource));
+        stages.push_back(Compile(GL_FRAGMENT_SHADER, source.FragmentSource));
+    }
     
-    glAttachShader(program, vs);
-    glAttachShader(program, fs);
+    // Some drivers only keep a retrievable binary when asked before linking
+    if (!s_CacheDirectory.empty())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    
+    // A stage that failed to compile is 0, linking then fails and says so
+    for (unsigned int stage : stages)
+    {
+        if (stage)
+            glAttachShader(program, stage);
+    }
     glLinkProgram(program);
+    
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked)
+    {
+        int length;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> message(length + 1);
+        
+        glGetProgramInfoLog(program, length, &length, message.data());
+        std::cout << "Failed to link " << m_FilePath << "!" << std::endl;
+        std::cout << message.data() << std::endl;
+    }
+    
+#ifdef DEBUG
+    // Validates against the current state, only telling in a debug build
     glValidateProgram(program);
+#endif
+    
+    for (unsigned int stage : stages)
+        glDeleteShader(stage);
+    
+    return program;
+}
+
+unsigned int Shader::Create(const ShaderProgramSource& source)
+{
+    using Clock = std::chrono::steady_clock;
+    
+    uint64_t key = 0;
+    if (!s_CacheDirectory.empty())
+    {
+        key = hashProgram(source);
+        
+        auto start = Clock::now();
+        unsigned int program = LoadBinary(key);
+        if (program)
+        {
+            s_CacheStats.Hits++;
+            s_CacheStats.LoadMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            return program;
+        }
+    }
     
-    glDeleteShader(vs);
-    glDeleteShader(fs);
+    auto start = Clock::now();
+    unsigned int program = Link(source);
+    s_CacheStats.Misses++;
+    s_CacheStats.CompileMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    
+    if (!s_CacheDirectory.empty())
+        StoreBinary(key, program);
     
     return program;
 }
 
+unsigned int Shader::LoadBinary(uint64_t key) const
+{
+    std::ifstream stream(binaryPath(key), std::ios::binary);
+    if (!stream)
+        return 0;
+    
+    ProgramBinaryHeader header;
+    stream.read((char*)&header, sizeof(header));
+    if (!stream || memcmp(header.Magic, s_BinaryMagic, sizeof(s_BinaryMagic)) != 0 || header.Key != key)
+        return 0;
+    
+    // A truncated or corrupt file must not decide how much gets allocated
+    std::streamoff headerEnd = stream.tellg();
+    stream.seekg(0, std::ios::end);
+    std::streamoff remaining = stream.tellg() - headerEnd;
+    if (header.Length > s_MaxBinaryLength || (std::streamoff)header.Length > remaining)
+    {
+        std::cout << "Ignoring corrupt shader cache entry " << binaryPath(key) << std::endl;
+        s_CacheStats.Rejected++;
+        return 0;
+    }
+    stream.seekg(headerEnd);
+    
+    std::vector<char> binary(header.Length);
+    stream.read(binary.data(), binary.size());
+    if (!stream)
+        return 0;
+    
+    // An unknown format is an error, not just a failed link
+    if (!isBinaryFormatSupported(header.Format))
+    {
+        s_CacheStats.Rejected++;
+        return 0;
+    }
+    
+    unsigned int program;
+    GLCall(program = glCreateProgram());
+    GLCall(glProgramBinary(program, header.Format, binary.data(), (int)binary.size()));
+    
+    int linked;
+    GLCall(glGetProgramiv(program, GL_LINK_STATUS, &linked));
+    if (!linked)
+    {
+        // The caller compiles from source and overwrites the file
+        s_CacheStats.Rejected++;
+        GLCall(glDeleteProgram(program));
+        return 0;
+    }
+    
+    return program;
+}
+
+void Shader::StoreBinary(uint64_t key, unsigned int program) const
+{
+    // 0 for a program that did not link, or when the driver has no binary formats
+    int length = 0;
+    GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length == 0)
+        return;
+    
+    ProgramBinaryHeader header;
+    memcpy(header.Magic, s_BinaryMagic, sizeof(s_BinaryMagic));
+    header.Key = key;
+    
+    std::vector<char> binary(length);
+    GLCall(glGetProgramBinary(program, length, &length, &header.Format, binary.data()));
+    header.Length = length;
+    
+    // Written aside and renamed, so another process never reads half a file
+    std::string path = binaryPath(key);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream stream(temporary, std::ios::binary);
+        stream.write((const char*)&header, sizeof(header));
+        stream.write(binary.data(), length);
+        
+        if (!stream)
+        {
+            std::cout << "Warning: could not write " << temporary << std::endl;
+            return;
+        }
+    }
+    
+    std::rename(temporary.c_str(), path.c_str());
+}
+
+void Shader::SetBinaryCacheDirectory(const std::string& directory)
+{
+    s_CacheDirectory = directory;
+    if (!directory.empty())
+        mkdir(directory.c_str(), 0755);
+}
+
+const ShaderCacheStats& Shader::GetCacheStats()
+{
+    return s_CacheStats;
+}
 
 Shader::Shader(const std::string& filepath)
 : m_FilePath(filepath), m_RendererID(0)
 {
-    GLCall(ShaderProgramSource source = Parse(filepath));
-    GLCall(m_RendererID = Create(source.VertexSource, source.FragmentSource));
+    ShaderProgramSource source = ShaderParser::Parse(filepath);
+    GLCall(m_RendererID = Create(source));
+    Reflect();
+    
+    if (g_ShaderWatcher)
+        g_ShaderWatcher->Register(*this);
+}
+
+Shader::Shader(const std::string& filepath, const std::vector<std::string>& defines)
+: m_FilePath(filepath), m_RendererID(0), m_Defines(defines)
+{
+    ShaderProgramSource source = ShaderParser::Parse(filepath, m_Defines);
+    GLCall(m_RendererID = Create(source));
+    Reflect();
+    
+    if (g_ShaderWatcher)
+        g_ShaderWatcher->Register(*this);
 }
 
 Shader::~Shader()
 {
+    if (g_ShaderWatcher)
+        g_ShaderWatcher->Unregister(*this);
+    
     GLCall(glDeleteProgram(m_RendererID));
 }
 
@@ -102,6 +335,172 @@ void Shader::Unbind() const
     GLCall(glUseProgram(0));
 }
 
+void Shader::Reflect()
+{
+    // Uniforms the new program dropped stay in the table, set to nothing
+    for (ShaderUniform& uniform : m_Uniforms)
+        uniform.location = -1;
+    
+    int count = 0, maxLength = 0;
+    GLCall(glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORMS, &count));
+    GLCall(glGetProgramiv(m_RendererID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+    
+    std::vector<char> buffer(maxLength + 1);
+    for (int i = 0; i < count; i++)
+    {
+        ShaderUniform uniform;
+        int length = 0;
+        GLCall(glGetActiveUniform(m_RendererID, i, (int)buffer.size(), &length,
+                                  &uniform.size, &uniform.type, buffer.data()));
+        
+        uniform.name.assign(buffer.data(), length);
+        GLCall(uniform.location = glGetUniformLocation(m_RendererID, uniform.name.c_str()));
+        
+        // Arrays are reported as "u_Textures[0]", they are set through their base name
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+        
+        uniform.hash = HashUniformName(uniform.name.data(), uniform.name.size());
+        
+        auto existing = std::find_if(m_Uniforms.begin(), m_Uniforms.end(),
+                                     [&uniform](const ShaderUniform& other) { return other.name == uniform.name; });
+        if (existing != m_Uniforms.end())
+            *existing = uniform;
+        else
+            m_Uniforms.push_back(uniform);
+    }
+    
+    m_UniformsByHash.resize(m_Uniforms.size());
+    for (unsigned int i = 0; i < m_Uniforms.size(); i++)
+        m_UniformsByHash[i] = i;
+    
+    std::sort(m_UniformsByHash.begin(), m_UniformsByHash.end(),
+              [this](unsigned int a, unsigned int b) { return m_Uniforms[a].hash < m_Uniforms[b].hash; });
+    
+    for (size_t i = 1; i < m_UniformsByHash.size(); i++)
+    {
+        const ShaderUniform& previous = m_Uniforms[m_UniformsByHash[i - 1]];
+        const ShaderUniform& current = m_Uniforms[m_UniformsByHash[i]];
+        if (current.hash == previous.hash)
+        {
+            std::cout << "Warning: uniforms '" << previous.name << "' and '" <<
+            current.name << "' share a hash in " << m_FilePath << std::endl;
+        }
+    }
+    
+    m_MVPUniform = GetUniformHandle("u_MVP"_uniform);
+}
+
+// One element of a uniform from one program to another, false for types it does not handle
+static bool copyUniform(unsigned int from, int fromLocation, unsigned int to, int toLocation, unsigned int type)
+{
+    int integer;
+    float value[16];
+    
+    switch (type)
+    {
+        case GL_INT:
+        case GL_BOOL:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+            GLCall(glGetUniformiv(from, fromLocation, &integer));
+            GLCall(glProgramUniform1i(to, toLocation, integer));
+            return true;
+        case GL_FLOAT:
+        case GL_FLOAT_VEC2:
+        case GL_FLOAT_VEC3:
+        case GL_FLOAT_VEC4:
+        case GL_FLOAT_MAT2:
+        case GL_FLOAT_MAT3:
+        case GL_FLOAT_MAT4:
+            GLCall(glGetUniformfv(from, fromLocation, value));
+            break;
+        default:
+            return false;
+    }
+    
+    switch (type)
+    {
+        case GL_FLOAT:      GLCall(glProgramUniform1fv(to, toLocation, 1, value)); break;
+        case GL_FLOAT_VEC2: GLCall(glProgramUniform2fv(to, toLocation, 1, value)); break;
+        case GL_FLOAT_VEC3: GLCall(glProgramUniform3fv(to, toLocation, 1, value)); break;
+        case GL_FLOAT_VEC4: GLCall(glProgramUniform4fv(to, toLocation, 1, value)); break;
+        case GL_FLOAT_MAT2: GLCall(glProgramUniformMatrix2fv(to, toLocation, 1, GL_FALSE, value)); break;
+        case GL_FLOAT_MAT3: GLCall(glProgramUniformMatrix3fv(to, toLocation, 1, GL_FALSE, value)); break;
+        case GL_FLOAT_MAT4: GLCall(glProgramUniformMatrix4fv(to, toLocation, 1, GL_FALSE, value)); break;
+    }
+    
+    return true;
+}
+
+void Shader::Swap(unsigned int program)
+{
+    unsigned int previousProgram = m_RendererID;
+    std::vector<ShaderUniform> previousUniforms = m_Uniforms;
+    
+    m_RendererID = program;
+    m_MissingUniforms.clear();
+    Reflect();
+    
+    // Values set once at startup (samplers, tuning constants) would otherwise reset to 0.
+    // Reflect() keeps indices, so entry i is the same uniform before and after
+    for (size_t i = 0; i < previousUniforms.size(); i++)
+    {
+        const ShaderUniform& before = previousUniforms[i];
+        const ShaderUniform& after = m_Uniforms[i];
+        if (before.location < 0 || after.location < 0 || before.type != after.type)
+            continue;
+        
+        for (int element = 0; element < std::min(before.size, after.size); element++)
+        {
+            std::string name = before.size > 1 ? before.name + "[" + std::to_string(element) + "]" : before.name;
+            
+            int fromLocation, toLocation;
+            GLCall(fromLocation = glGetUniformLocation(previousProgram, name.c_str()));
+            GLCall(toLocation = glGetUniformLocation(program, name.c_str()));
+            
+            if (fromLocation >= 0 && toLocation >= 0)
+                copyUniform(previousProgram, fromLocation, program, toLocation, before.type);
+        }
+    }
+    
+    GLCall(glDeleteProgram(previousProgram));
+}
+
+UniformHandle Shader::GetUniformHandle(uint32_t nameHash) const
+{
+    auto it = std::lower_bound(m_UniformsByHash.begin(), m_UniformsByHash.end(), nameHash,
+                               [this](unsigned int index, uint32_t hash) { return m_Uniforms[index].hash < hash; });
+    
+    UniformHandle handle;
+    if (it != m_UniformsByHash.end() && m_Uniforms[*it].hash == nameHash)
+        handle.index = (int)*it;
+    
+    return handle;
+}
+
+void Shader::SetUniform1i(UniformHandle uniform, int value) const
+{
+    GLCall(glUniform1i(GetUniformLocation(uniform), value));
+}
+
+void Shader::SetUniform1iv(UniformHandle uniform, int count, const int* values) const
+{
+    GLCall(glUniform1iv(GetUniformLocation(uniform), count, values));
+}
+
+void Shader::SetUniform4f(UniformHandle uniform, float v0, float v1, float v2, float v3) const
+{
+    GLCall(glUniform4f(GetUniformLocation(uniform), v0, v1, v2, v3));
+}
+
+void Shader::SetUniformMat4f(UniformHandle uniform, const glm::mat4& value) const
+{
+    GLCall(glUniformMatrix4fv(GetUniformLocation(uniform), 1, GL_FALSE, &value[0][0]));
+}
+
 void Shader::SetUniform4f(const std::string& name,
                           float v0, float v1, float v2, float v3) const
 {
@@ -113,25 +512,31 @@ void Shader::SetUniform1i(const std::string& name, int value) const
     GLCall(glUniform1i(GetUniformLocation(name), value));
 }
 
-void Shader::SetUniformMat4f(const std::string &name, const glm::mat4 &value)
+void Shader::SetUniform1iv(const std::string& name, int count, const int* values) const
+{
+    GLCall(glUniform1iv(GetUniformLocation(name), count, values));
+}
+
+void Shader::SetUniformMat4f(const std::string &name, const glm::mat4 &value) const
 {
     GLCall(glUniformMatrix4fv(GetUniformLocation(name),1,GL_FALSE, &value[0][0]));
 }
 
 int Shader::GetUniformLocation(const std::string& name) const
 {
+    uint32_t hash = HashUniformName(name.data(), name.size());
+    UniformHandle uniform = GetUniformHandle(hash);
     
-    if (m_UniformLocationCache.find(name) != m_UniformLocationCache.end())
+    if (!uniform.IsValid())
     {
-        return m_UniformLocationCache.at(name);
-    }
-    
-    GLCall(int location = glGetUniformLocation(m_RendererID, name.c_str()));
-    if (location == -1)
-    {
-        std::cout << "Warning: uniform '" << name << "' doesn't exist" << std::endl;
+        // Warn once per name, not every frame
+        if (std::find(m_MissingUniforms.begin(), m_MissingUniforms.end(), hash) == m_MissingUniforms.end())
+        {
+            m_MissingUniforms.push_back(hash);
+            std::cout << "Warning: uniform '" << name << "' doesn't exist" << std::endl;
+        }
+        return -1;
     }
     
-//    m_UniformLocationCache.insert({name, location});
-    return location;
+    return m_Uniforms[uniform.index].location;
 }
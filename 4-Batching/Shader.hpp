@@ -1,37 +1,122 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
 #include <string>
-#include <unordered_map>
+#include <vector>
+
+#include "ShaderParser.hpp"
 
 #include "vendor/glm/glm.hpp"
 
-struct ShaderProgramSource
+// FNV-1a, constexpr so "u_MVP"_uniform is hashed at compile time
+constexpr uint32_t HashUniformName(const char* name, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    return hash;
+}
+
+constexpr uint32_t operator""_uniform(const char* name, size_t length)
+{
+    return HashUniformName(name, length);
+}
+
+// One active uniform, as reported by glGetActiveUniform after linking
+struct ShaderUniform
+{
+    uint32_t hash;
+    int location;
+    unsigned int type;
+    int size;
+    std::string name;
+};
+
+// Index into a shader's uniform table, resolve once and keep it
+struct UniformHandle
+{
+    int index = -1;
+    
+    inline bool IsValid() const { return index >= 0; }
+};
+
+// Since the start of the process, over every Shader
+struct ShaderCacheStats
 {
-    std::string VertexSource;
-    std::string FragmentSource;
+    unsigned int Hits = 0;      // Programs loaded with glProgramBinary
+    unsigned int Misses = 0;    // Programs compiled from source
+    unsigned int Rejected = 0;  // Binaries the driver refused, e.g. after an update
+    double LoadMs = 0.0;
+    double CompileMs = 0.0;
 };
 
 
 class Shader
 {
+    // Recompiles and swaps programs when the file changes
+    friend class ShaderWatcher;
+    
 private:
     std::string m_FilePath;
     unsigned int m_RendererID;
-    std::unordered_map<std::string, int> m_UniformLocationCache;
+    std::vector<std::string> m_Defines;
+    // Filled by Reflect() once the program is linked. A UniformHandle indexes
+    // it, so a reload keeps every existing entry where it is
+    std::vector<ShaderUniform> m_Uniforms;
+    // Indices into m_Uniforms sorted by hash, for GetUniformHandle()
+    std::vector<unsigned int> m_UniformsByHash;
+    // u_MVP, set for every queued draw, so looked up once by Reflect()
+    UniformHandle m_MVPUniform;
+    mutable std::vector<uint32_t> m_MissingUniforms;
 public:
     Shader(const std::string& filepath);
+    // Every entry ("NAME" or "NAME VALUE") becomes a #define after #version
+    Shader(const std::string& filepath, const std::vector<std::string>& defines);
     ~Shader();
     
+    // Linked programs are stored in `directory` with glGetProgramBinary and loaded
+    // back on the next run. Keyed by the final sources, GL_RENDERER and
+    // GL_VERSION, so a driver update recompiles. "" (the default) turns it off
+    static void SetBinaryCacheDirectory(const std::string& directory);
+    static const ShaderCacheStats& GetCacheStats();
+    
     void Bind() const;
     void Unbind() const;
     
+    inline unsigned int GetRendererID() const { return m_RendererID; }
+    inline const std::string& GetFilePath() const { return m_FilePath; }
+    
+    UniformHandle GetUniformHandle(uint32_t nameHash) const;
+    inline UniformHandle GetUniformHandle(const std::string& name) const
+    { return GetUniformHandle(HashUniformName(name.data(), name.size())); }
+    
+    inline const std::vector<ShaderUniform>& GetUniforms() const { return m_Uniforms; }
+    // Invalid when the program has no u_MVP
+    inline UniformHandle GetMVPUniform() const { return m_MVPUniform; }
+    
+    void SetUniform1i(UniformHandle uniform, int value) const;
+    void SetUniform1iv(UniformHandle uniform, int count, const int* values) const;
+    void SetUniform4f(UniformHandle uniform, float v0, float v1, float v2, float v3) const;
+    void SetUniformMat4f(UniformHandle uniform, const glm::mat4& value) const;
+    
+    // Convenience for one-off setup, hot paths should keep a UniformHandle
     void SetUniform1i(const std::string& name, int value) const;
+    void SetUniform1iv(const std::string& name, int count, const int* values) const;
     void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3) const;
-    void SetUniformMat4f(const std::string& name, const glm::mat4& value);
+    void SetUniformMat4f(const std::string& name, const glm::mat4& value) const;
     
 private:
     int GetUniformLocation(const std::string& name) const;
-    unsigned int Create(const std::string& vertexShader, const std::string& fragmentShader);
+    inline int GetUniformLocation(UniformHandle uniform) const
+    { return uniform.IsValid() ? m_Uniforms[uniform.index].location : -1; }
+    void Reflect();
+    // Replaces the program with `program`, linked from the same file, keeping uniform values
+    void Swap(unsigned int program);
+    unsigned int Create(const ShaderProgramSource& source);
     unsigned int Compile(unsigned int type, const std::string& source);
-    ShaderProgramSource Parse(const std::string& filepath);
+    unsigned int Link(const ShaderProgramSource& source);
+    // 0 if there is no usable binary for `key`
+    unsigned int LoadBinary(uint64_t key) const;
+    void StoreBinary(uint64_t key, unsigned int program) const;
 };
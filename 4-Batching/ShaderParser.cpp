@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ShaderParser.hpp"
+
+enum class ShaderStage
+{ NONE = -1, VERTEX = 0, FRAGMENT = 1, GEOMETRY = 2, COMPUTE = 3 };
+
+struct CachedInclude
+{
+    std::shared_ptr<const std::string> Text;
+    long long Modified;
+    long long Size;
+};
+
+static std::mutex s_Mutex;
+static std::string s_IncludeRoot;
+static std::unordered_map<std::string, CachedInclude> s_Includes;
+static ShaderParser::Stats s_Stats;
+
+static bool startsWith(std::string_view text, std::string_view prefix)
+{
+    return text.size() >= prefix.size() && text.compare(0, prefix.size(), prefix) == 0;
+}
+
+static std::string_view trimLeft(std::string_view text)
+{
+    size_t first = text.find_first_not_of(" \t");
+    return first == std::string_view::npos ? std::string_view() : text.substr(first);
+}
+
+// Nanoseconds where the platform has them, a save within the same second still shows
+static long long modifiedTime(const struct stat& info)
+{
+#if defined(__APPLE__)
+    return (long long)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    return (long long)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    return (long long)info.st_mtime * 1000000000;
+#endif
+}
+
+// Whole file in one read, false if it is not a readable file
+static bool readFile(const std::string& path, std::string& text, struct stat& info)
+{
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode))
+    {
+        close(file);
+        return false;
+    }
+
+    text.resize((size_t)info.st_size);
+    size_t total = 0;
+    while (total < text.size())
+    {
+        ssize_t count = read(file, &text[total], text.size() - total);
+        if (count <= 0)
+            break;
+        total += (size_t)count;
+    }
+    text.resize(total);
+    close(file);
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_Stats.FilesRead++;
+    s_Stats.BytesRead += total;
+
+    return true;
+}
+
+static std::shared_ptr<const std::string> loadInclude(const std::string& path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        auto cached = s_Includes.find(path);
+        if (cached != s_Includes.end() && cached->second.Modified == modifiedTime(info) &&
+            cached->second.Size == (long long)info.st_size)
+        {
+            s_Stats.IncludeCacheHits++;
+            return cached->second.Text;
+        }
+    }
+
+    // Stamped with what was read, a write in between is picked up next time
+    auto text = std::make_shared<std::string>();
+    if (!readFile(path, *text, info))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_Includes[path] = { text, modifiedTime(info), (long long)info.st_size };
+
+    return text;
+}
+
+static std::string directoryOf(const std::string& path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+struct ParseState
+{
+    ShaderProgramSource& Source;
+    const std::vector<std::string>& Defines;
+    std::string IncludeRoot;
+    ShaderStage Stage = ShaderStage::NONE;
+    std::vector<std::string> Included[4]; // Per stage, for include-once
+    // Where each stage starts in its output and in the file, for defines without a #version
+    size_t StageBegin[4] = {};
+    int StageLine[4] = {};                 // 0 while the stage has not been seen
+    bool HasVersion[4] = {};
+
+    std::string& Output()
+    {
+        switch (Stage)
+        {
+            case ShaderStage::FRAGMENT: return Source.FragmentSource;
+            case ShaderStage::GEOMETRY: return Source.GeometrySource;
+            case ShaderStage::COMPUTE:  return Source.ComputeSource;
+            default:                    return Source.VertexSource;
+        }
+    }
+};
+
+static void appendLine(std::string& output, int line, int file)
+{
+    output += "#line ";
+    output += std::to_string(line);
+    output += ' ';
+    output += std::to_string(file);
+    output += '\n';
+}
+
+static void appendDefines(std::string& output, const std::vector<std::string>& defines)
+{
+    for (const std::string& define : defines)
+    {
+        output += "#define ";
+        output += define;
+        output += '\n';
+    }
+}
+
+static void parseText(ParseState& state, std::string_view text, const std::string& path, int fileIndex, bool topLevel)
+{
+    int lineNumber = 0;
+    size_t begin = 0;
+
+    // Plain lines are not copied one by one but as whole runs, up to the next directive
+    size_t run = std::string_view::npos;
+    auto flush = [&](size_t end)
+    {
+        if (run == std::string_view::npos)
+            return;
+
+        std::string& output = state.Output();
+        output.append(text.data() + run, end - run);
+        if (output.back() != '\n')
+            output += '\n';
+        run = std::string_view::npos;
+    };
+
+    while (begin < text.size())
+    {
+        size_t lineBegin = begin;
+        size_t end = std::min(text.find('\n', begin), text.size());
+        std::string_view line = text.substr(begin, end - begin);
+        begin = std::min(end + 1, text.size());
+        lineNumber++;
+
+        std::string_view directive = trimLeft(line);
+        bool isShader = startsWith(directive, "#shader");
+        bool isInclude = !isShader && startsWith(directive, "#include");
+
+        if (!isShader && !isInclude)
+        {
+            if (state.Stage == ShaderStage::NONE)
+                continue;
+
+            if (run == std::string_view::npos)
+                run = lineBegin;
+
+            // #version has to stay the first statement
+            if (startsWith(directive, "#version"))
+            {
+                flush(begin);
+
+                std::string& output = state.Output();
+                appendDefines(output, state.Defines);
+                appendLine(output, lineNumber + 1, fileIndex);
+                state.HasVersion[(int)state.Stage] = true;
+            }
+            continue;
+        }
+
+        flush(lineBegin);
+
+        if (!directive.empty() && directive.back() == '\r')
+            directive.remove_suffix(1);
+
+        if (isShader)
+        {
+            if (!topLevel)
+            {
+                std::cout << "Warning: #shader inside included " << path << " is ignored" << std::endl;
+                if (state.Stage != ShaderStage::NONE)
+                    state.Output() += '\n';
+                continue;
+            }
+
+            if (directive.find("vertex") != std::string_view::npos)
+                state.Stage = ShaderStage::VERTEX;
+            else if (directive.find("fragment") != std::string_view::npos)
+                state.Stage = ShaderStage::FRAGMENT;
+            else if (directive.find("geometry") != std::string_view::npos)
+                state.Stage = ShaderStage::GEOMETRY;
+            else if (directive.find("compute") != std::string_view::npos)
+                state.Stage = ShaderStage::COMPUTE;
+            else
+            {
+                std::cout << "Warning: unknown stage '" << directive << "' in " << path << std::endl;
+                state.Stage = ShaderStage::NONE;
+            }
+
+            if (state.Stage != ShaderStage::NONE && state.StageLine[(int)state.Stage] == 0)
+            {
+                state.StageBegin[(int)state.Stage] = state.Output().size();
+                state.StageLine[(int)state.Stage] = lineNumber + 1;
+            }
+            continue;
+        }
+
+        if (state.Stage == ShaderStage::NONE)
+            continue;
+
+        // A skipped include still takes its line, later lines keep their numbers
+        std::string& output = state.Output();
+
+        std::string_view argument = trimLeft(directive.substr(8));
+        size_t close = argument.empty() ? std::string_view::npos : argument.find(argument[0] == '<' ? '>' : '"', 1);
+        if (close == std::string_view::npos || (argument[0] != '"' && argument[0] != '<'))
+        {
+            std::cout << "Malformed include in " << path << ":" << lineNumber << std::endl;
+            output += '\n';
+            continue;
+        }
+
+        std::string name(argument.substr(1, close - 1));
+        std::string includePath = directoryOf(path) + name;
+        std::shared_ptr<const std::string> included = loadInclude(includePath);
+        if (!included && !state.IncludeRoot.empty())
+        {
+            includePath = state.IncludeRoot + "/" + name;
+            included = loadInclude(includePath);
+        }
+
+        if (!included)
+        {
+            std::cout << "Could not include " << name << " from " << path << ":" << lineNumber << std::endl;
+            output += '\n';
+            continue;
+        }
+
+        std::vector<std::string>& once = state.Included[(int)state.Stage];
+        if (std::find(once.begin(), once.end(), includePath) != once.end())
+        {
+            output += '\n';
+            continue;
+        }
+        once.push_back(includePath);
+
+        std::vector<std::string>& files = state.Source.Files;
+        auto known = std::find(files.begin(), files.end(), includePath);
+        int includeIndex = (int)(known - files.begin());
+        if (known == files.end())
+            files.push_back(includePath);
+
+        appendLine(output, 1, includeIndex);
+        parseText(state, *included, includePath, includeIndex, false);
+        appendLine(output, lineNumber + 1, fileIndex);
+    }
+
+    flush(text.size());
+}
+
+ShaderProgramSource ShaderParser::Parse(const std::string& filepath, const std::vector<std::string>& defines)
+{
+    ShaderProgramSource source;
+    source.Files.push_back(filepath);
+
+    struct stat info;
+    std::string text;
+    if (!readFile(filepath, text, info))
+    {
+        std::cout << "Could not read " << filepath << std::endl;
+        return source;
+    }
+
+    ParseState state { source, defines, std::string(), ShaderStage::NONE, {} };
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        state.IncludeRoot = s_IncludeRoot;
+    }
+
+    // Includes only add to it, most stages never grow past this
+    source.VertexSource.reserve(text.size());
+    source.FragmentSource.reserve(text.size());
+
+    parseText(state, text, filepath, 0, true);
+
+    // A stage without #version has nothing that must come first, its defines open it
+    for (int stage = 0; stage < 4 && !defines.empty(); stage++)
+    {
+        if (state.StageLine[stage] == 0 || state.HasVersion[stage])
+            continue;
+
+        state.Stage = (ShaderStage)stage;
+        std::string& output = state.Output();
+        if (output.size() == state.StageBegin[stage])
+            continue;
+
+        std::string prefix;
+        appendDefines(prefix, defines);
+        appendLine(prefix, state.StageLine[stage], 0);
+        output.insert(state.StageBegin[stage], prefix);
+    }
+
+    return source;
+}
+
+void ShaderParser::SetIncludeRoot(const std::string& root)
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_IncludeRoot = root;
+}
+
+void ShaderParser::ClearIncludeCache()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    s_Includes.clear();
+}
+
+ShaderParser::Stats ShaderParser::GetStats()
+{
+    std::lock_guard<std::mutex> lock(s_Mutex);
+    return s_Stats;
+}
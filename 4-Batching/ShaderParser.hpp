@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ShaderProgramSource
+{
+    std::string VertexSource;
+    std::string FragmentSource;
+    std::string GeometrySource; // Optional
+    std::string ComputeSource;  // A compute program has no other stage
+    // Every file read, the shader itself first: index i is source string i in #line
+    std::vector<std::string> Files;
+};
+
+/*
+ Splits a .shader file into its stages.
+
+ The file is read in one go and walked as string_views, lines are only
+ copied once, into the stage they belong to. Lines before the first
+ "#shader vertex|fragment|geometry|compute" marker belong to no stage.
+
+ #include "name" (or <name>) is looked up next to the including file,
+ then under the include root. A file is included once per stage, which
+ also ends include cycles. Included files are cached across shaders and
+ threads, and re-read only when their modification time or size
+ changes. #line directives around every include and after #version keep
+ compiler errors pointing at the right file and line.
+
+ `defines` ("NAME" or "NAME VALUE") become #defines right after #version,
+ or at the start of a stage that has none, so one file builds any
+ number of permutations.
+ */
+class ShaderParser
+{
+public:
+    struct Stats
+    {
+        unsigned int FilesRead = 0;
+        unsigned int IncludeCacheHits = 0;
+        uint64_t BytesRead = 0;
+    };
+
+    static ShaderProgramSource Parse(const std::string& filepath, const std::vector<std::string>& defines = {});
+
+    // "" (the default) only looks next to the including file
+    static void SetIncludeRoot(const std::string& root);
+    static void ClearIncludeCache();
+
+    static Stats GetStats();
+};
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <set>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
+#include "ShaderWatcher.hpp"
+#include "Renderer.h"
+
+// GL_KHR_parallel_shader_compile, newer than the glad header
+#ifndef GL_COMPLETION_STATUS_KHR
+    #define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ShaderWatcher* g_ShaderWatcher = nullptr;
+
+static bool hasExtension(const char* name)
+{
+    int count = 0;
+    GLCall(glGetIntegerv(GL_NUM_EXTENSIONS, &count));
+
+    for (int i = 0; i < count; i++)
+    {
+        const char* extension;
+        GLCall(extension = (const char*)glGetStringi(GL_EXTENSIONS, i));
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+static void printShaderLog(unsigned int shader)
+{
+    int compiled;
+    GLCall(glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled));
+    if (compiled)
+        return;
+
+    int length;
+    GLCall(glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length));
+    std::vector<char> message(length + 1);
+    GLCall(glGetShaderInfoLog(shader, length, &length, message.data()));
+
+    int type;
+    GLCall(glGetShaderiv(shader, GL_SHADER_TYPE, &type));
+    const char* stage = type == GL_VERTEX_SHADER ? "Vertex" : type == GL_FRAGMENT_SHADER ? "Fragment" :
+                        type == GL_GEOMETRY_SHADER ? "Geometry" : "Compute";
+
+    std::cout << stage << " shader: " << message.data() << std::endl;
+}
+
+ShaderWatcher::ShaderWatcher()
+:   m_Quit(false),
+    m_ParallelCompile(false)
+{
+    // The driver picks its own number of compiler threads, glMaxShaderCompilerThreadsKHR is not loaded
+    m_ParallelCompile = hasExtension("GL_KHR_parallel_shader_compile") || hasExtension("GL_ARB_parallel_shader_compile");
+
+    m_Thread = std::thread(&ShaderWatcher::WatchLoop, this);
+
+    g_ShaderWatcher = this;
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+    if (g_ShaderWatcher == this)
+        g_ShaderWatcher = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_Wake.notify_all();
+    m_Thread.join();
+
+    for (Compilation& compilation : m_Compilations)
+        Discard(compilation);
+}
+
+void ShaderWatcher::Register(Shader& shader)
+{
+    m_Shaders.push_back(&shader);
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Variants[Variant(shader.GetFilePath(), shader.m_Defines)]++;
+    }
+    m_Wake.notify_all();
+}
+
+void ShaderWatcher::Unregister(Shader& shader)
+{
+    m_Shaders.erase(std::remove(m_Shaders.begin(), m_Shaders.end(), &shader), m_Shaders.end());
+
+    for (size_t i = 0; i < m_Compilations.size();)
+    {
+        if (m_Compilations[i].Target == &shader)
+        {
+            Discard(m_Compilations[i]);
+            m_Compilations.erase(m_Compilations.begin() + i);
+        }
+        else
+            i++;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto variant = m_Variants.find(Variant(shader.GetFilePath(), shader.m_Defines));
+    if (variant != m_Variants.end() && --variant->second == 0)
+        m_Variants.erase(variant);
+}
+
+void ShaderWatcher::Update()
+{
+    std::map<Variant, ShaderProgramSource> parsed;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        parsed.swap(m_Parsed);
+    }
+
+    for (const auto& variant : parsed)
+    {
+        for (Shader* shader : m_Shaders)
+        {
+            if (shader->GetFilePath() == variant.first.first && shader->m_Defines == variant.first.second)
+                Start(*shader, variant.second);
+        }
+    }
+
+    for (size_t i = 0; i < m_Compilations.size();)
+    {
+        if (Finish(m_Compilations[i]))
+            m_Compilations.erase(m_Compilations.begin() + i);
+        else
+            i++;
+    }
+}
+
+void ShaderWatcher::Start(Shader& shader, const ShaderProgramSource& source)
+{
+    // A newer save supersedes a compile still in flight
+    for (size_t i = 0; i < m_Compilations.size(); i++)
+    {
+        if (m_Compilations[i].Target == &shader)
+        {
+            Discard(m_Compilations[i]);
+            m_Compilations.erase(m_Compilations.begin() + i);
+            break;
+        }
+    }
+
+    Compilation compilation;
+    compilation.Target = &shader;
+
+    std::vector<std::pair<unsigned int, const std::string*>> stages;
+    if (!source.ComputeSource.empty())
+        stages.emplace_back(GL_COMPUTE_SHADER, &source.ComputeSource);
+    else
+    {
+        stages.emplace_back(GL_VERTEX_SHADER, &source.VertexSource);
+        if (!source.GeometrySource.empty())
+            stages.emplace_back(GL_GEOMETRY_SHADER, &source.GeometrySource);
+        stages.emplace_back(GL_FRAGMENT_SHADER, &source.FragmentSource);
+    }
+
+    // None of these wait for the compiler, only the status queries can
+    GLCall(compilation.Program = glCreateProgram());
+
+    for (const auto& stage : stages)
+    {
+        const char* text = stage.second->c_str();
+
+        unsigned int id;
+        GLCall(id = glCreateShader(stage.first));
+        GLCall(glShaderSource(id, 1, &text, nullptr));
+        GLCall(glCompileShader(id));
+        GLCall(glAttachShader(compilation.Program, id));
+
+        compilation.Stages.push_back(id);
+    }
+
+    GLCall(glLinkProgram(compilation.Program));
+
+    m_Compilations.push_back(compilation);
+}
+
+bool ShaderWatcher::Finish(Compilation& compilation)
+{
+    if (m_ParallelCompile)
+    {
+        int completed;
+        GLCall(glGetProgramiv(compilation.Program, GL_COMPLETION_STATUS_KHR, &completed));
+        if (!completed)
+            return false;
+    }
+
+    const std::string& path = compilation.Target->GetFilePath();
+
+    int linked;
+    GLCall(glGetProgramiv(compilation.Program, GL_LINK_STATUS, &linked));
+    if (!linked)
+    {
+        std::cout << "Reloading " << path << " failed, keeping the previous program" << std::endl;
+        for (unsigned int stage : compilation.Stages)
+            printShaderLog(stage);
+
+        int length;
+        GLCall(glGetProgramiv(compilation.Program, GL_INFO_LOG_LENGTH, &length));
+        std::vector<char> message(length + 1);
+        GLCall(glGetProgramInfoLog(compilation.Program, length, &length, message.data()));
+        std::cout << message.data() << std::endl;
+
+        Discard(compilation);
+        m_Stats.Failures++;
+        return true;
+    }
+
+    for (unsigned int stage : compilation.Stages)
+    {
+        GLCall(glDeleteShader(stage));
+    }
+
+    compilation.Target->Swap(compilation.Program);
+    m_Stats.Reloads++;
+
+    std::cout << "Reloaded " << path << std::endl;
+    return true;
+}
+
+void ShaderWatcher::Discard(Compilation& compilation)
+{
+    for (unsigned int stage : compilation.Stages)
+    {
+        GLCall(glDeleteShader(stage));
+    }
+    GLCall(glDeleteProgram(compilation.Program));
+}
+
+void ShaderWatcher::WatchLoop()
+{
+#ifdef __linux__
+    // Directories, not files: editors often save by renaming a new file over the old one
+    int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    std::map<int, std::string> watches;
+    std::set<std::string> watchedDirectories;
+    alignas(struct inotify_event) char events[4096];
+#else
+    std::map<std::string, std::pair<long long, long long>> stamps; // Path, modification time and size
+#endif
+
+    // Every file each variant read, learned by parsing it here once
+    std::map<Variant, std::vector<std::string>> dependencies;
+
+    while (true)
+    {
+        std::vector<Variant> variants;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+#ifndef __linux__
+            m_Wake.wait_for(lock, std::chrono::milliseconds(250));
+#endif
+            if (m_Quit)
+                break;
+
+            for (const auto& variant : m_Variants)
+                variants.push_back(variant.first);
+        }
+
+        for (auto it = dependencies.begin(); it != dependencies.end();)
+        {
+            if (std::find(variants.begin(), variants.end(), it->first) == variants.end())
+                it = dependencies.erase(it);
+            else
+                ++it;
+        }
+
+        std::set<std::string> files;
+        for (const Variant& variant : variants)
+        {
+            auto known = dependencies.find(variant);
+            if (known == dependencies.end())
+                known = dependencies.emplace(variant, ShaderParser::Parse(variant.first, variant.second).Files).first;
+
+            files.insert(known->second.begin(), known->second.end());
+        }
+
+        std::set<std::string> changed;
+
+#ifdef __linux__
+        for (const std::string& file : files)
+        {
+            size_t slash = file.rfind('/');
+            std::string directory = slash == std::string::npos ? "." : file.substr(0, slash);
+
+            if (watchedDirectories.insert(directory).second)
+            {
+                int watch = inotify_add_watch(notify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (watch >= 0)
+                    watches[watch] = directory;
+                else
+                    std::cout << "[ShaderWatcher] Could not watch " << directory << std::endl;
+            }
+        }
+
+        // Short enough to notice a new registration or the destructor
+        pollfd descriptor = { notify, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        ssize_t length;
+        while ((length = read(notify, events, sizeof(events))) > 0)
+        {
+            for (char* next = events; next < events + length; )
+            {
+                const inotify_event* event = (const inotify_event*)next;
+                next += sizeof(inotify_event) + event->len;
+
+                if (event->len == 0 || watches.find(event->wd) == watches.end())
+                    continue;
+
+                const std::string& directory = watches[event->wd];
+                std::string path = directory == "." ? event->name : directory + "/" + event->name;
+                if (files.count(path))
+                    changed.insert(path);
+            }
+        }
+#else
+        for (const std::string& file : files)
+        {
+            struct stat info;
+            if (stat(file.c_str(), &info) != 0)
+                continue;
+
+    #ifdef __APPLE__
+            long long modified = (long long)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+    #else
+            long long modified = (long long)info.st_mtime * 1000000000;
+    #endif
+            std::pair<long long, long long> stamp(modified, (long long)info.st_size);
+
+            auto known = stamps.find(file);
+            if (known == stamps.end())
+                stamps[file] = stamp;
+            else if (known->second != stamp)
+            {
+                known->second = stamp;
+                changed.insert(file);
+            }
+        }
+#endif
+
+        if (changed.empty())
+            continue;
+
+        for (auto& variant : dependencies)
+        {
+            std::vector<std::string>& reads = variant.second;
+            if (std::none_of(reads.begin(), reads.end(), [&](const std::string& file) { return changed.count(file) > 0; }))
+                continue;
+
+            ShaderProgramSource source = ShaderParser::Parse(variant.first.first, variant.first.second);
+
+            // Caught between truncation and write, the next event brings the rest
+            if (source.VertexSource.empty() && source.FragmentSource.empty() && source.ComputeSource.empty())
+                continue;
+
+            // An edit may have added or dropped an #include
+            reads = source.Files;
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Parsed[variant.first] = std::move(source);
+        }
+    }
+
+#ifdef __linux__
+    close(notify);
+#endif
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Shader.hpp"
+
+/*
+ Hot reloads shaders while the program runs.
+
+ Every Shader built while a ShaderWatcher exists registers its file and
+ defines. A background thread watches the file and everything it
+ #includes (inotify on Linux, modification times everywhere else) and
+ re-parses every permutation that reads a file as soon as it is
+ written, so no file I/O happens on the render thread.
+
+ Update(), on the render thread once a frame, starts compiling and
+ linking the new sources for every Shader of that permutation. With
+ GL_KHR_parallel_shader_compile the driver compiles on its own threads
+ and Update() only polls GL_COMPLETION_STATUS_KHR, so a reload never
+ waits on the compiler; without it the status query in the next frame
+ may. Once linked, the program replaces the old one between two frames
+ and the uniform table is rebuilt, with existing UniformHandles still
+ valid and uniform values carried over. A program that fails to link
+ is dropped with its log and the old one keeps running.
+
+ Swapping changes program names behind the Renderer's back: call
+ Update() before Renderer::InvalidateState().
+ */
+class ShaderWatcher
+{
+public:
+    struct Stats
+    {
+        unsigned int Reloads = 0;   // Programs swapped
+        unsigned int Failures = 0;  // Reloads that did not compile or link
+    };
+
+private:
+    struct Compilation
+    {
+        Shader* Target;
+        unsigned int Program;
+        std::vector<unsigned int> Stages;
+    };
+
+    // A file and its defines, what one Shader was built from
+    using Variant = std::pair<std::string, std::vector<std::string>>;
+
+    // Shared with the watching thread
+    std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::map<Variant, unsigned int> m_Variants;          // Shaders built from each
+    std::map<Variant, ShaderProgramSource> m_Parsed;     // Changed, waiting for Update()
+    bool m_Quit;
+    std::thread m_Thread;
+
+    // Render thread only
+    std::vector<Shader*> m_Shaders;
+    std::vector<Compilation> m_Compilations;
+    bool m_ParallelCompile;
+    Stats m_Stats;
+
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+
+    ShaderWatcher(const ShaderWatcher&) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+    // Called by Shader itself
+    void Register(Shader& shader);
+    void Unregister(Shader& shader);
+
+    // Starts compiling changed files and swaps in whatever finished linking
+    void Update();
+
+    inline bool HasParallelCompile() const { return m_ParallelCompile; }
+    inline unsigned int GetCompiling() const { return (unsigned int)m_Compilations.size(); }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    void Start(Shader& shader, const ShaderProgramSource& source);
+    // True once `compilation` is finished, swapped in or dropped
+    bool Finish(Compilation& compilation);
+    void Discard(Compilation& compilation);
+    void WatchLoop();
+};
+
+extern ShaderWatcher* g_ShaderWatcher;
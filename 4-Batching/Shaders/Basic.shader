@@ -22,16 +22,14 @@ uniform sampler2D u_Texture;
 
 in vec2 v_TexCoord;
 
+#include "TextureOrColor.glsl"
+
 void main()
 {
-    vec4 texColor = texture(u_Texture, v_TexCoord);
-    if (texColor[0] != 0 && texColor[1] != 0)
-    {
-        color = texColor;
-        // color = vec4(1.0f, 1.0f, 1.0f, 1.0f);
-    }
-    else
-    {
-        color = u_Color;
-    }
+    color = TextureOrColor(u_Texture, v_TexCoord, u_Color);
+
+#ifdef UI_PASS
+    // UI quads let the gameplay layer drawn before them show through
+    color.a *= 0.5;
+#endif
 }
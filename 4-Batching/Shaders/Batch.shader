@@ -0,0 +1,50 @@
+#shader vertex
+#version 330 core
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+layout(location = 3) in float texIndex;
+
+out vec2 v_TexCoord;
+out vec4 v_Color;
+out float v_TexIndex;
+
+uniform mat4 u_ViewProjection;
+
+void main()
+{
+    gl_Position = u_ViewProjection * vec4(position, 1.0);
+    v_TexCoord = texCoord;
+    v_Color = color;
+    v_TexIndex = texIndex;
+}
+
+#shader fragment
+#version 330 core
+layout(location = 0) out vec4 color;
+
+// MAX_TEXTURE_SLOTS and SAMPLE_TEXTURE_SLOTS are injected by BatchRenderer2D
+uniform sampler2D u_Textures[MAX_TEXTURE_SLOTS];
+
+in vec2 v_TexCoord;
+in vec4 v_Color;
+in float v_TexIndex;
+
+vec4 SampleSlot(int slot, vec2 uv, vec2 dx, vec2 dy)
+{
+    switch (slot)
+    {
+        SAMPLE_TEXTURE_SLOTS
+    }
+    return vec4(1.0);
+}
+
+void main()
+{
+    // Gradients are taken outside the switch, where control flow is still uniform
+    vec2 dx = dFdx(v_TexCoord);
+    vec2 dy = dFdy(v_TexCoord);
+    
+    // Slot 0 is white, so flat colored quads come out as v_Color
+    color = SampleSlot(int(v_TexIndex + 0.5), v_TexCoord, dx, dy) * v_Color;
+}
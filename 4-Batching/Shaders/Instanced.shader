@@ -0,0 +1,32 @@
+#shader vertex
+#version 330 core
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec2 texCoord;
+// Per instance, a mat4 takes locations 2 to 5
+layout(location = 2) in mat4 i_Model;
+
+out vec2 v_TexCoord;
+
+uniform mat4 u_ViewProjection;
+
+void main()
+{
+    gl_Position = u_ViewProjection * i_Model * position;
+    v_TexCoord = texCoord;
+}
+
+#shader fragment
+#version 330 core
+layout(location = 0) out vec4 color;
+
+uniform vec4 u_Color;
+uniform sampler2D u_Texture;
+
+in vec2 v_TexCoord;
+
+#include "TextureOrColor.glsl"
+
+void main()
+{
+    color = TextureOrColor(u_Texture, v_TexCoord, u_Color);
+}
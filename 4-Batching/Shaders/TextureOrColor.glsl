@@ -0,0 +1,9 @@
+// The texel where the texture has one, `fallback` where it is black
+vec4 TextureOrColor(sampler2D tex, vec2 uv, vec4 fallback)
+{
+    vec4 texColor = texture(tex, uv);
+    if (texColor[0] != 0 && texColor[1] != 0)
+        return texColor;
+
+    return fallback;
+}
@@ -0,0 +1,206 @@
+#include <cmath>
+
+#include "SpatialGrid.hpp"
+
+// Both coordinates in one key, negative ones included
+static inline uint64_t cellKey(int x, int y)
+{
+    return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+SpatialGrid::SpatialGrid(float cellSize)
+:   m_CellSize(cellSize),
+    m_InverseCellSize(1.0f / cellSize),
+    m_MaxHalfExtent(0.0f)
+{
+}
+
+uint32_t SpatialGrid::GetCell(int x, int y)
+{
+    auto found = m_CellIndex.find(cellKey(x, y));
+    if (found != m_CellIndex.end())
+        return found->second;
+
+    uint32_t index = (uint32_t)m_Cells.size();
+    m_Cells.emplace_back();
+    m_CellIndex[cellKey(x, y)] = index;
+    m_Stats.Cells++;
+
+    return index;
+}
+
+const SpatialGrid::Cell* SpatialGrid::FindCell(int x, int y) const
+{
+    auto found = m_CellIndex.find(cellKey(x, y));
+    return found != m_CellIndex.end() ? &m_Cells[found->second] : nullptr;
+}
+
+bool SpatialGrid::Contains(uint32_t id) const
+{
+    return id < m_ItemCell.size() && m_ItemCell[id] != 0;
+}
+
+void SpatialGrid::Shrink(uint32_t cell, const glm::vec4& bounds, const glm::vec2& halfExtent)
+{
+    Cell& c = m_Cells[cell];
+    glm::vec2 old = (glm::vec2(bounds.z, bounds.w) - glm::vec2(bounds.x, bounds.y)) * 0.5f;
+
+    // Only the item holding the cell's largest extent can lower it
+    bool held = (old.x >= c.MaxHalfExtent.x && halfExtent.x < old.x) ||
+                (old.y >= c.MaxHalfExtent.y && halfExtent.y < old.y);
+    if (held && !c.Stale)
+    {
+        c.Stale = true;
+        m_StaleCells.push_back(cell);
+    }
+}
+
+void SpatialGrid::RecalculateMaxHalfExtent()
+{
+    for (uint32_t index : m_StaleCells)
+    {
+        Cell& cell = m_Cells[index];
+        cell.MaxHalfExtent = glm::vec2(0.0f);
+        for (const glm::vec4& b : cell.Bounds)
+            cell.MaxHalfExtent = glm::max(cell.MaxHalfExtent, (glm::vec2(b.z, b.w) - glm::vec2(b.x, b.y)) * 0.5f);
+        cell.Stale = false;
+    }
+    m_StaleCells.clear();
+
+    m_MaxHalfExtent = glm::vec2(0.0f);
+    for (const Cell& cell : m_Cells)
+        m_MaxHalfExtent = glm::max(m_MaxHalfExtent, cell.MaxHalfExtent);
+}
+
+void SpatialGrid::Update(uint32_t id, const glm::vec2& min, const glm::vec2& max)
+{
+    glm::vec2 center = (min + max) * 0.5f;
+    glm::vec2 halfExtent = (max - min) * 0.5f;
+
+    uint32_t cell = GetCell((int)std::floor(center.x * m_InverseCellSize),
+                            (int)std::floor(center.y * m_InverseCellSize));
+    glm::vec4 bounds(min, max);
+
+    if (id >= m_ItemCell.size())
+    {
+        m_ItemCell.resize(id + 1, 0);
+        m_ItemSlot.resize(id + 1, 0);
+    }
+
+    // Still under the same cell, the common case for anything moving slowly
+    if (m_ItemCell[id] == cell + 1)
+    {
+        glm::vec4& current = m_Cells[cell].Bounds[m_ItemSlot[id]];
+        Shrink(cell, current, halfExtent);
+        current = bounds;
+    }
+    else
+    {
+        Remove(id);
+
+        m_ItemCell[id] = cell + 1;
+        m_ItemSlot[id] = (uint32_t)m_Cells[cell].Ids.size();
+        m_Cells[cell].Ids.push_back(id);
+        m_Cells[cell].Bounds.push_back(bounds);
+        m_Stats.Items++;
+    }
+
+    m_Cells[cell].MaxHalfExtent = glm::max(m_Cells[cell].MaxHalfExtent, halfExtent);
+    m_MaxHalfExtent = glm::max(m_MaxHalfExtent, halfExtent);
+}
+
+void SpatialGrid::Remove(uint32_t id)
+{
+    if (!Contains(id))
+        return;
+
+    Cell& cell = m_Cells[m_ItemCell[id] - 1];
+    uint32_t slot = m_ItemSlot[id];
+    Shrink(m_ItemCell[id] - 1, cell.Bounds[slot]);
+
+    // The last item of the cell fills the gap
+    uint32_t last = cell.Ids.back();
+    cell.Ids[slot] = last;
+    cell.Bounds[slot] = cell.Bounds.back();
+    m_ItemSlot[last] = slot;
+    cell.Ids.pop_back();
+    cell.Bounds.pop_back();
+
+    m_ItemCell[id] = 0;
+    m_Stats.Items--;
+}
+
+void SpatialGrid::Clear()
+{
+    for (Cell& cell : m_Cells)
+    {
+        cell.Ids.clear();
+        cell.Bounds.clear();
+        cell.MaxHalfExtent = glm::vec2(0.0f);
+        cell.Stale = false;
+    }
+    m_StaleCells.clear();
+
+    m_ItemCell.clear();
+    m_ItemSlot.clear();
+    m_MaxHalfExtent = glm::vec2(0.0f);
+    m_Stats.Items = 0;
+}
+
+unsigned int SpatialGrid::QueryCell(const Cell& cell, const glm::vec2& min, const glm::vec2& max,
+                                    std::vector<uint32_t>& ids)
+{
+    for (uint32_t i = 0; i < (uint32_t)cell.Ids.size(); i++)
+    {
+        const glm::vec4& b = cell.Bounds[i];
+        if (b.x <= max.x && b.z >= min.x && b.y <= max.y && b.w >= min.y)
+            ids.push_back(cell.Ids[i]);
+    }
+
+    return (unsigned int)cell.Ids.size();
+}
+
+void SpatialGrid::Query(const glm::vec2& min, const glm::vec2& max, std::vector<uint32_t>& ids)
+{
+    if (!m_StaleCells.empty())
+        RecalculateMaxHalfExtent();
+
+    // Centers may lie outside [min, max] by up to the largest half extent. Clamped
+    // so a degenerate view still converts to int
+    glm::vec2 looseMin = glm::clamp((min - m_MaxHalfExtent) * m_InverseCellSize, -1e9f, 1e9f);
+    glm::vec2 looseMax = glm::clamp((max + m_MaxHalfExtent) * m_InverseCellSize, -1e9f, 1e9f);
+
+    int x0 = (int)std::floor(looseMin.x), y0 = (int)std::floor(looseMin.y);
+    int x1 = (int)std::floor(looseMax.x), y1 = (int)std::floor(looseMax.y);
+
+    unsigned int visited = 0;
+    unsigned int tested = 0;
+
+    // A view far larger than the populated area would visit mostly missing cells
+    if (((int64_t)x1 - x0 + 1) * ((int64_t)y1 - y0 + 1) > (int64_t)m_Cells.size())
+    {
+        for (const Cell& cell : m_Cells)
+        {
+            visited++;
+            tested += QueryCell(cell, min, max, ids);
+        }
+    }
+    else
+    {
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                const Cell* cell = FindCell(x, y);
+                if (!cell)
+                    continue;
+
+                visited++;
+                tested += QueryCell(*cell, min, max, ids);
+            }
+        }
+    }
+
+    m_Stats.CellsVisited = visited;
+    m_Stats.ItemsTested = tested;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "vendor/glm/glm.hpp"
+
+/*
+ Loose uniform grid over 2D bounding boxes, for finding what a view
+ rectangle overlaps without testing everything.
+
+ Each item lives in exactly one cell, the one under the center of its
+ box, so there are no duplicates to weed out and moving an item within
+ its cell only rewrites the box. Query() widens the rectangle by the
+ largest half extent of the items in the grid, which catches items
+ reaching in from neighbouring cells. Every cell keeps its own largest
+ one; when the item holding it shrinks or leaves, only that cell is
+ scanned again, before the next query. Items much larger than a cell therefore make
+ every query visit more cells; pick the cell size around the size of a
+ typical item or a bit larger.
+
+ Cells are allocated on demand in a hash map, the world has no bounds.
+ Ids are chosen by the caller, e.g. an entity index, and index a flat
+ array, so keep them dense.
+ */
+class SpatialGrid
+{
+public:
+    struct Stats
+    {
+        unsigned int Items = 0;
+        unsigned int Cells = 0;          // Allocated, including emptied ones
+        unsigned int CellsVisited = 0;   // Last Query()
+        unsigned int ItemsTested = 0;    // Last Query()
+    };
+
+private:
+    // Boxes next to their ids, so a query streams through both
+    struct Cell
+    {
+        std::vector<uint32_t> Ids;
+        std::vector<glm::vec4> Bounds;   // min.x, min.y, max.x, max.y
+        glm::vec2 MaxHalfExtent = glm::vec2(0.0f);
+        bool Stale = false;              // MaxHalfExtent may be too large, in m_StaleCells
+    };
+
+    float m_CellSize;
+    float m_InverseCellSize;
+    glm::vec2 m_MaxHalfExtent;           // Over every cell, once m_StaleCells is empty
+    std::vector<uint32_t> m_StaleCells;
+
+    std::unordered_map<uint64_t, uint32_t> m_CellIndex;
+    std::vector<Cell> m_Cells;
+    // Per id: cell index + 1 (0 when not inserted) and position in the cell
+    std::vector<uint32_t> m_ItemCell;
+    std::vector<uint32_t> m_ItemSlot;
+
+    Stats m_Stats;
+
+public:
+    SpatialGrid(float cellSize = 8.0f);
+
+    // Inserts `id` or moves it to its new box
+    void Update(uint32_t id, const glm::vec2& min, const glm::vec2& max);
+    void Remove(uint32_t id);
+    void Clear();
+    bool Contains(uint32_t id) const;
+
+    // Appends the ids of every box overlapping [min, max], in no particular order
+    void Query(const glm::vec2& min, const glm::vec2& max, std::vector<uint32_t>& ids);
+
+    inline float GetCellSize() const { return m_CellSize; }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    uint32_t GetCell(int x, int y);
+    // Null if the cell was never allocated
+    const Cell* FindCell(int x, int y) const;
+    // `bounds` is leaving `cell` or being replaced by a box smaller than `halfExtent`
+    void Shrink(uint32_t cell, const glm::vec4& bounds, const glm::vec2& halfExtent = glm::vec2(0.0f));
+    // Rescans the stale cells and takes the largest half extent over all of them
+    void RecalculateMaxHalfExtent();
+    // Appends the overlapping ids of one cell, returns how many were tested
+    static unsigned int QueryCell(const Cell& cell, const glm::vec2& min, const glm::vec2& max,
+                                  std::vector<uint32_t>& ids);
+};
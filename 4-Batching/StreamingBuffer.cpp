@@ -0,0 +1,146 @@
+#include "StreamingBuffer.hpp"
+#include "Renderer.h"
+
+StreamingBuffer::StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount,
+                                 bool allowPersistent)
+:   m_RendererID(0),
+    m_Target(target),
+    m_Mode(Mode::MAP_RANGE),
+    m_RegionSize(regionSize),
+    m_RegionCount(regionCount),
+    m_Region(0),
+    m_Offset(0),
+    m_PersistentPointer(nullptr),
+    m_Fences(regionCount, nullptr),
+    m_MappedOffset(0),
+    m_Mapped(false)
+{
+    unsigned int size = regionSize * regionCount;
+    
+    GLCall(glGenBuffers(1, &m_RendererID));
+    GLCall(glBindBuffer(m_Target, m_RendererID));
+    
+    if (allowPersistent && GLAD_GL_VERSION_4_4 && glBufferStorage)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        
+        GLCall(glBufferStorage(m_Target, size, nullptr, flags));
+        GLCall(m_PersistentPointer = (unsigned char*)glMapBufferRange(m_Target, 0, size, flags));
+        
+        if (m_PersistentPointer)
+            m_Mode = Mode::PERSISTENT;
+    }
+    
+    if (m_Mode == Mode::MAP_RANGE)
+    {
+        // Immutable storage can't be respecified, start over with a fresh name
+        if (allowPersistent && GLAD_GL_VERSION_4_4 && glBufferStorage)
+        {
+            GLCall(glDeleteBuffers(1, &m_RendererID));
+            GLCall(glGenBuffers(1, &m_RendererID));
+            GLCall(glBindBuffer(m_Target, m_RendererID));
+        }
+        
+        GLCall(glBufferData(m_Target, size, nullptr, GL_STREAM_DRAW));
+    }
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    for (void* fence : m_Fences)
+    {
+        if (fence)
+        {
+            GLCall(glDeleteSync((GLsync)fence));
+        }
+    }
+    
+    if (m_PersistentPointer)
+    {
+        GLCall(glBindBuffer(m_Target, m_RendererID));
+        GLCall(glUnmapBuffer(m_Target));
+    }
+    
+    GLCall(glDeleteBuffers(1, &m_RendererID));
+}
+
+void* StreamingBuffer::Map(unsigned int size, unsigned int alignment)
+{
+    ASSERT(!m_Mapped && size <= m_RegionSize);
+    // Region starts are multiples of the region size, so they must be aligned too
+    ASSERT(m_RegionSize % alignment == 0);
+    
+    unsigned int offset = (m_Offset + alignment - 1) / alignment * alignment;
+    if (offset + size > m_RegionSize)
+    {
+        NextRegion();
+        offset = 0;
+    }
+    
+    m_MappedOffset = m_Region * m_RegionSize + offset;
+    m_Offset = offset + size;
+    m_Mapped = true;
+    m_Stats.BytesWritten += size;
+    
+    if (m_Mode == Mode::PERSISTENT)
+        return m_PersistentPointer + m_MappedOffset;
+    
+    // The fence already proved this range is free, tell the driver not to check
+    void* pointer;
+    Bind();
+    GLCall(pointer = glMapBufferRange(m_Target, m_MappedOffset, size,
+                                      GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    return pointer;
+}
+
+unsigned int StreamingBuffer::Unmap()
+{
+    ASSERT(m_Mapped);
+    m_Mapped = false;
+    
+    if (m_Mode == Mode::MAP_RANGE)
+    {
+        Bind();
+        GLCall(glUnmapBuffer(m_Target));
+    }
+    
+    return m_MappedOffset;
+}
+
+void StreamingBuffer::NextRegion()
+{
+    // Everything submitted so far may read the region being left
+    GLCall(m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    
+    m_Region = (m_Region + 1) % m_RegionCount;
+    m_Offset = 0;
+    
+    GLsync fence = (GLsync)m_Fences[m_Region];
+    if (!fence)
+        return;
+    
+    GLenum result;
+    GLCall(result = glClientWaitSync(fence, 0, 0));
+    if (result == GL_TIMEOUT_EXPIRED)
+    {
+        m_Stats.FenceWaits++;
+        do
+        {
+            GLCall(result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+        }
+        while (result == GL_TIMEOUT_EXPIRED);
+    }
+    
+    GLCall(glDeleteSync(fence));
+    m_Fences[m_Region] = nullptr;
+}
+
+void StreamingBuffer::Bind() const
+{
+    GLCall(glBindBuffer(m_Target, m_RendererID));
+}
+
+void StreamingBuffer::Unbind() const
+{
+    GLCall(glBindBuffer(m_Target, 0));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+/*
+ Ring of regions in one GL buffer for data rewritten every frame. Writes
+ go into ranges the GPU is known to be done with, so nothing is ever
+ reallocated and the driver never has to synchronize behind our back.
+ 
+ A fence is placed on a region when the ring moves past it and waited on
+ when the ring comes back around. With three or more regions the wait is
+ normally already signaled.
+ 
+ Memory comes from one of two paths:
+ - PERSISTENT: glBufferStorage with GL_MAP_PERSISTENT_BIT |
+   GL_MAP_COHERENT_BIT (GL 4.4), mapped once for the buffer's lifetime
+ - MAP_RANGE: glMapBufferRange with GL_MAP_UNSYNCHRONIZED_BIT |
+   GL_MAP_INVALIDATE_RANGE_BIT for each allocation, e.g. on macOS
+ */
+class StreamingBuffer
+{
+public:
+    enum class Mode
+    { PERSISTENT = 0, MAP_RANGE = 1 };
+    
+    struct Stats
+    {
+        unsigned int FenceWaits = 0;   // Waits that actually blocked on the GPU
+        unsigned int BytesWritten = 0;
+    };
+    
+private:
+    unsigned int m_RendererID;
+    unsigned int m_Target;
+    Mode m_Mode;
+    
+    unsigned int m_RegionSize;
+    unsigned int m_RegionCount;
+    unsigned int m_Region;
+    unsigned int m_Offset;
+    
+    unsigned char* m_PersistentPointer;
+    std::vector<void*> m_Fences; // GLsync per region, null once waited on
+    
+    unsigned int m_MappedOffset;
+    bool m_Mapped;
+    
+    Stats m_Stats;
+    
+public:
+    // `target` is the binding the buffer is used through, e.g. GL_ARRAY_BUFFER
+    StreamingBuffer(unsigned int target, unsigned int regionSize, unsigned int regionCount = 3,
+                    bool allowPersistent = true);
+    ~StreamingBuffer();
+    
+    StreamingBuffer(const StreamingBuffer&) = delete;
+    StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+    
+    // Room for `size` bytes aligned to `alignment`, valid until Unmap()
+    void* Map(unsigned int size, unsigned int alignment = 4);
+    // Returns the byte offset, in the whole buffer, of the data just written
+    unsigned int Unmap();
+    
+    void Bind() const;
+    void Unbind() const;
+    
+    inline unsigned int GetRendererID() const { return m_RendererID; }
+    inline Mode GetMode() const { return m_Mode; }
+    inline unsigned int GetRegionSize() const { return m_RegionSize; }
+    inline const Stats& GetStats() const { return m_Stats; }
+    inline void ResetStats() { m_Stats = Stats(); }
+    
+private:
+    void NextRegion();
+};
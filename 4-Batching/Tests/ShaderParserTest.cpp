@@ -0,0 +1,92 @@
+/*
+ Checks where ShaderParser puts defines: right after #version, and at
+ the start of a stage that has no #version (only comments or code
+ before its first line). No GL needed. Prints every failed check and
+ exits with 1 if there was one.
+
+ Build and run on Linux or macOS from 4-Batching:
+   g++ -std=gnu++17 -O2 Tests/ShaderParserTest.cpp ShaderParser.cpp \
+       -lpthread -o shader-parser-test
+   ./shader-parser-test
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <unistd.h>
+
+#include "../ShaderParser.hpp"
+
+static int s_Failures = 0;
+
+static void check(bool condition, const std::string& what, const std::string& source)
+{
+    if (condition)
+        return;
+
+    std::cout << "FAILED: " << what << "\n---\n" << source << "---" << std::endl;
+    s_Failures++;
+}
+
+static std::string writeShader(const std::string& text)
+{
+    char path[] = "/tmp/shader-parser-test-XXXXXX";
+    int file = mkstemp(path);
+    if (file < 0)
+    {
+        std::cout << "Could not create a temporary file" << std::endl;
+        exit(1);
+    }
+    close(file);
+
+    std::ofstream(path) << text;
+    return path;
+}
+
+static bool startsWith(const std::string& text, const std::string& prefix)
+{
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+int main()
+{
+    std::string path = writeShader(
+        "#shader vertex\n"
+        "#version 330 core\n"
+        "void main() {}\n"
+        "#shader fragment\n"
+        "// No #version in this stage\n"
+        "out vec4 color;\n"
+        "void main() { color = vec4(1.0); }\n");
+
+    ShaderProgramSource source = ShaderParser::Parse(path, { "UI_PASS", "LEVEL 2" });
+
+    // With #version: the version line, the defines, then a #line back to the file
+    const std::string& vertex = source.VertexSource;
+    check(startsWith(vertex, "#version 330 core\n#define UI_PASS\n#define LEVEL 2\n#line 3 0\n"),
+          "defines follow #version", vertex);
+
+    // Without: the defines open the stage, the #line points at the line after #shader
+    const std::string& fragment = source.FragmentSource;
+    check(startsWith(fragment, "#define UI_PASS\n#define LEVEL 2\n#line 5 0\n// No #version"),
+          "defines open a stage without #version", fragment);
+    check(fragment.find("#define UI_PASS", 1) == std::string::npos, "defines written once", fragment);
+
+    // No defines, nothing added
+    ShaderProgramSource plain = ShaderParser::Parse(path);
+    check(startsWith(plain.FragmentSource, "// No #version"), "nothing added without defines", plain.FragmentSource);
+
+    unlink(path.c_str());
+
+    if (s_Failures)
+    {
+        std::cout << s_Failures << " checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -1,14 +1,29 @@
 #include "Texture.hpp"
+#include "TextureFile.hpp"
 #include "vendor/stb_image.h"
 
+#include <iostream>
+
+// GL_EXT_texture_compression_s3tc, not in the core profile glad was generated for
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT  0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+
 Texture::Texture(const std::string& path)
 :   m_RendererID(0),
     m_FilePath(path),
     m_LocalBuffer(nullptr),
-    m_Width(0), m_Height(0), m_BPP(0)
+    m_Width(0), m_Height(0), m_BPP(0),
+    m_MemorySize(0)
 {
+    if (path.size() > 5 && path.compare(path.size() - 5, 5, ".ctex") == 0)
+    {
+        LoadCooked(path);
+        return;
+    }
+    
     stbi_set_flip_vertically_on_load(1);
     m_LocalBuffer = stbi_load(path.c_str(), &m_Width, &m_Height, &m_BPP, 4);
+    m_MemorySize = m_Width * m_Height * 4;
     
     GLCall(glGenTextures(1, &m_RendererID));
     GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
@@ -27,6 +42,108 @@ Texture::Texture(const std::string& path)
     }
 }
 
+Texture::Texture(int width, int height, const unsigned char* pixels)
+:   m_RendererID(0),
+    m_LocalBuffer(nullptr),
+    m_Width(width), m_Height(height), m_BPP(4),
+    m_MemorySize(width * height * 4)
+{
+    GLCall(glGenTextures(1, &m_RendererID));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void Texture::SetData(int width, int height, const void* pixels)
+{
+    m_Width = width;
+    m_Height = height;
+    m_MemorySize = width * height * 4;
+    
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
+void Texture::LoadCooked(const std::string& path)
+{
+    GLCall(glGenTextures(1, &m_RendererID));
+    GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+    
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    
+    TextureFile file(path);
+    if (!file.IsValid())
+    {
+        // Magenta stands out on screen, and callers still get a texture they can sample
+        std::cout << "[Texture] Could not load " << path << ", using a 1x1 placeholder" << std::endl;
+        
+        const unsigned char placeholder[4] = { 255, 0, 255, 255 };
+        m_BPP = 4;
+        
+        GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        SetData(1, 1, placeholder);
+        return;
+    }
+    
+    m_Width = file.GetWidth();
+    m_Height = file.GetHeight();
+    m_BPP = TextureFile::GetChannelCount(file.GetFormat());
+    
+    unsigned int internalFormat = GL_RGBA8, format = GL_RGBA;
+    
+    // One and two channel formats read back as grey and grey + alpha, like the PNG would
+    int swizzle[4] = { GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA };
+    if (m_BPP == 1 || m_BPP == 2)
+    {
+        swizzle[0] = swizzle[1] = swizzle[2] = GL_RED;
+        swizzle[3] = m_BPP == 1 ? GL_ONE : GL_GREEN;
+    }
+    
+    switch (file.GetFormat())
+    {
+        case TextureFile::Format::R8:    internalFormat = GL_R8;  format = GL_RED; break;
+        case TextureFile::Format::RG8:   internalFormat = GL_RG8; format = GL_RG;  break;
+        case TextureFile::Format::RGBA8: break;
+        case TextureFile::Format::BC1:   internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;  break;
+        case TextureFile::Format::BC3:   internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+        case TextureFile::Format::BC4:   internalFormat = GL_COMPRESSED_RED_RGTC1;          break;
+    }
+    
+    GLCall(glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, file.GetLevelCount() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+    GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, file.GetLevelCount() - 1));
+    
+    // R8 and RG8 rows are not padded to 4 bytes
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    
+    for (unsigned int i = 0; i < file.GetLevelCount(); i++)
+    {
+        const TextureFile::Level& level = file.GetLevel(i);
+        m_MemorySize += level.Size;
+        
+        if (TextureFile::IsCompressed(file.GetFormat()))
+        {
+            GLCall(glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.Width, level.Height, 0, level.Size, level.Data));
+        }
+        else
+        {
+            GLCall(glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.Width, level.Height, 0, format, GL_UNSIGNED_BYTE, level.Data));
+        }
+    }
+    
+    GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+    GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+}
+
 Texture::~Texture()
 {
     GLCall(glDeleteTextures(1, &m_RendererID));
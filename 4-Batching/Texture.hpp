@@ -9,14 +9,33 @@ private:
     std::string m_FilePath;
     unsigned char* m_LocalBuffer;
     int m_Width, m_Height, m_BPP;
+    unsigned int m_MemorySize;
     
 public:
+    // Decodes PNG/JPEG/... with stb_image, or maps a *.ctex cooked by Tools/TextureCooker
     Texture(const std::string& filepath);
+    // RGBA8 texture from raw pixels, e.g. a 1x1 white texture for untextured quads
+    Texture(int width, int height, const unsigned char* pixels);
     ~Texture();
     
+    // Owns its GL name, copies would delete it twice
+    Texture(const Texture&) = delete;
+    Texture& operator=(const Texture&) = delete;
+    
+    // Replaces size and contents, the GL name stays. With a GL_PIXEL_UNPACK_BUFFER
+    // bound, `pixels` is a byte offset into it
+    void SetData(int width, int height, const void* pixels);
+    
     void Bind(unsigned int slot = 0) const;
     void Unbind();
     
+    inline unsigned int GetRendererID() const { return m_RendererID; }
     inline int GetWidth() const  { return m_Width; }
     inline int GetHeight() const { return m_Height; }
+    // Bytes of every level as uploaded, what the texture costs in video memory
+    inline unsigned int GetMemorySize() const { return m_MemorySize; }
+    
+private:
+    // Uploads every level of a cooked file straight from its mapping
+    void LoadCooked(const std::string& filepath);
 };
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "TextureFile.hpp"
+
+const unsigned char TextureFile::Identifier[12] = { 0xAB, 'C', 'T', 'X', ' ', '1', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static const unsigned int s_LevelAlignment = 16;
+// Enough for 32-bit sizes, and keeps the per-level shifts defined
+static const unsigned int s_MaxLevels = 32;
+
+TextureFile::TextureFile(const std::string& filepath)
+:   m_Mapping(nullptr),
+    m_MappingSize(0),
+    m_Header(nullptr)
+{
+    int file = open(filepath.c_str(), O_RDONLY);
+    if (file < 0)
+    {
+        std::cout << "[TextureFile] Could not open " << filepath << std::endl;
+        return;
+    }
+
+    struct stat info;
+    if (fstat(file, &info) == 0 && info.st_size >= (off_t)sizeof(Header))
+    {
+        m_MappingSize = (size_t)info.st_size;
+        m_Mapping = mmap(nullptr, m_MappingSize, PROT_READ, MAP_PRIVATE, file, 0);
+        if (m_Mapping == MAP_FAILED)
+            m_Mapping = nullptr;
+    }
+
+    // The mapping keeps the file alive on its own
+    close(file);
+
+    if (!m_Mapping)
+    {
+        std::cout << "[TextureFile] Could not map " << filepath << std::endl;
+        return;
+    }
+
+    const unsigned char* bytes = (const unsigned char*)m_Mapping;
+    const Header* header = (const Header*)bytes;
+
+    size_t indexEnd = sizeof(Header) + (size_t)header->LevelCount * sizeof(LevelIndex);
+    if (memcmp(header->Identifier, Identifier, sizeof(Identifier)) != 0 || header->LevelCount == 0 ||
+        header->LevelCount > s_MaxLevels || indexEnd > m_MappingSize)
+    {
+        std::cout << "[TextureFile] " << filepath << " is not a cooked texture" << std::endl;
+        return;
+    }
+
+    const LevelIndex* index = (const LevelIndex*)(bytes + sizeof(Header));
+    Format format = (Format)header->VkFormat;
+
+    if (format != Format::R8 && format != Format::RG8 && format != Format::RGBA8 &&
+        format != Format::BC1 && format != Format::BC3 && format != Format::BC4)
+    {
+        std::cout << "[TextureFile] " << filepath << " has unsupported format " << header->VkFormat << std::endl;
+        return;
+    }
+
+    for (unsigned int i = 0; i < header->LevelCount; i++)
+    {
+        Level level;
+        level.Width = std::max(1u, header->Width >> i);
+        level.Height = std::max(1u, header->Height >> i);
+        level.Size = (unsigned int)index[i].ByteLength;
+
+        // Written so a corrupt offset or length cannot wrap around and pass
+        bool inFile = index[i].ByteOffset <= m_MappingSize && index[i].ByteLength <= m_MappingSize - index[i].ByteOffset;
+        if (!inFile || index[i].ByteLength != GetLevelSize(format, level.Width, level.Height))
+        {
+            std::cout << "[TextureFile] " << filepath << " is truncated or corrupt at level " << i << std::endl;
+            m_Levels.clear();
+            return;
+        }
+
+        level.Data = bytes + index[i].ByteOffset;
+        m_Levels.push_back(level);
+    }
+
+    // Level data is read once, front to back, by the upload
+    madvise(m_Mapping, m_MappingSize, MADV_SEQUENTIAL);
+
+    m_Header = header;
+}
+
+TextureFile::~TextureFile()
+{
+    if (m_Mapping)
+        munmap(m_Mapping, m_MappingSize);
+}
+
+bool TextureFile::Write(const std::string& filepath, Format format, int width, int height,
+                        const std::vector<std::vector<unsigned char>>& levels)
+{
+    Header header = {};
+    memcpy(header.Identifier, Identifier, sizeof(Identifier));
+    header.VkFormat = (uint32_t)format;
+    header.TypeSize = 1;
+    header.Width = width;
+    header.Height = height;
+    header.LayerCount = 0;
+    header.FaceCount = 1;
+    header.LevelCount = (uint32_t)levels.size();
+
+    std::vector<LevelIndex> index(levels.size());
+    uint64_t offset = sizeof(Header) + levels.size() * sizeof(LevelIndex);
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        offset = (offset + s_LevelAlignment - 1) / s_LevelAlignment * s_LevelAlignment;
+        index[i].ByteOffset = offset;
+        index[i].ByteLength = levels[i].size();
+        offset += levels[i].size();
+    }
+
+    std::ofstream stream(filepath, std::ios::binary);
+    if (!stream)
+        return false;
+
+    stream.write((const char*)&header, sizeof(header));
+    stream.write((const char*)index.data(), index.size() * sizeof(LevelIndex));
+
+    for (size_t i = 0; i < levels.size(); i++)
+    {
+        static const char padding[s_LevelAlignment] = {};
+        stream.write(padding, index[i].ByteOffset - (uint64_t)stream.tellp());
+        stream.write((const char*)levels[i].data(), levels[i].size());
+    }
+
+    return (bool)stream;
+}
+
+bool TextureFile::IsCompressed(Format format)
+{
+    return format == Format::BC1 || format == Format::BC3 || format == Format::BC4;
+}
+
+unsigned int TextureFile::GetChannelCount(Format format)
+{
+    switch (format)
+    {
+        case Format::R8:
+        case Format::BC4:   return 1;
+        case Format::RG8:   return 2;
+        case Format::BC1:   return 3;
+        default:            return 4;
+    }
+}
+
+unsigned int TextureFile::GetLevelSize(Format format, int width, int height)
+{
+    unsigned int blocks = ((width + 3) / 4) * ((height + 3) / 4);
+
+    switch (format)
+    {
+        case Format::BC1:
+        case Format::BC4:   return blocks * 8;
+        case Format::BC3:   return blocks * 16;
+        default:            return width * height * GetChannelCount(format);
+    }
+}
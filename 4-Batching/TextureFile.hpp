@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ Cooked textures, written offline by Tools/TextureCooker.cpp and read
+ back by Texture("*.ctex") without decoding anything.
+
+ The layout follows KTX2: a 12 byte identifier, the KTX2 header fields
+ with Vulkan format codes, then one {offset, length} entry per mip
+ level, base level first. It keeps only what Texture needs: no data
+ format descriptor, key/value data or supercompression, and its own
+ identifier so KTX2 tools do not mistake it for the real thing.
+
+ Level data is 16 byte aligned and stored exactly as glTexImage2D or
+ glCompressedTexImage2D take it, rows bottom-up, so opening a file is an
+ mmap and uploading a level is a pointer into the mapping.
+ */
+class TextureFile
+{
+public:
+    // Vulkan (and KTX2) vkFormat values
+    enum class Format
+    {
+        R8 = 9, RG8 = 16, RGBA8 = 37,
+        BC1 = 131, BC3 = 137, BC4 = 139
+    };
+
+    struct Header
+    {
+        unsigned char Identifier[12];
+        uint32_t VkFormat;
+        uint32_t TypeSize;
+        uint32_t Width, Height, Depth;
+        uint32_t LayerCount, FaceCount, LevelCount;
+        uint32_t Supercompression;
+    };
+
+    struct LevelIndex
+    {
+        uint64_t ByteOffset;
+        uint64_t ByteLength;
+    };
+
+    struct Level
+    {
+        const unsigned char* Data;
+        unsigned int Size;
+        int Width, Height;
+    };
+
+    static const unsigned char Identifier[12];
+
+private:
+    void* m_Mapping;
+    size_t m_MappingSize;
+    const Header* m_Header;
+    std::vector<Level> m_Levels;
+
+public:
+    // Maps `filepath` read-only, check IsValid()
+    TextureFile(const std::string& filepath);
+    ~TextureFile();
+
+    TextureFile(const TextureFile&) = delete;
+    TextureFile& operator=(const TextureFile&) = delete;
+
+    // `levels` base level first, each GetLevelSize() bytes
+    static bool Write(const std::string& filepath, Format format, int width, int height,
+                      const std::vector<std::vector<unsigned char>>& levels);
+
+    static bool IsCompressed(Format format);
+    static unsigned int GetChannelCount(Format format);
+    static unsigned int GetLevelSize(Format format, int width, int height);
+
+    inline bool IsValid() const { return m_Header != nullptr; }
+    inline Format GetFormat() const { return (Format)m_Header->VkFormat; }
+    inline int GetWidth() const { return m_Header->Width; }
+    inline int GetHeight() const { return m_Header->Height; }
+    inline unsigned int GetLevelCount() const { return (unsigned int)m_Levels.size(); }
+    inline const Level& GetLevel(unsigned int level) const { return m_Levels[level]; }
+};
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "TextureLoader.hpp"
+#include "vendor/stb_image.h"
+
+// Opaque grey: neither vanishes against the clear color nor flashes like magenta
+static const unsigned char s_Placeholder[4] = { 128, 128, 128, 255 };
+
+TextureLoader::TextureLoader(unsigned int uploadBudget, unsigned int workerCount)
+:   m_UploadBudget(uploadBudget),
+    // Three frames of uploads in flight before the ring has to wait for the GPU
+    m_Staging(GL_PIXEL_UNPACK_BUFFER, uploadBudget),
+    m_Decoding(0),
+    m_Quit(false)
+{
+    // A bound unpack buffer turns every other glTexImage2D pointer into an offset
+    m_Staging.Unbind();
+
+    // hardware_concurrency() is 0 when unknown, and decoding needs at least one worker
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::max(1u, std::thread::hardware_concurrency()) - 1);
+
+    for (unsigned int i = 0; i < workerCount; i++)
+        m_Workers.emplace_back(&TextureLoader::WorkerLoop, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_RequestAdded.notify_all();
+
+    for (std::thread& worker : m_Workers)
+        worker.join();
+
+    for (Request& request : m_Decoded)
+        stbi_image_free(request.Pixels);
+}
+
+std::shared_ptr<Texture> TextureLoader::Load(const std::string& filepath, Callback onLoaded)
+{
+    auto texture = std::make_shared<Texture>(1, 1, s_Placeholder);
+
+    Request request;
+    request.Path = filepath;
+    request.Target = texture;
+    request.OnLoaded = std::move(onLoaded);
+    request.Requested = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Requests.push_back(std::move(request));
+    }
+    m_RequestAdded.notify_one();
+
+    m_Stats.Requested++;
+
+    return texture;
+}
+
+unsigned int TextureLoader::GetPending() const
+{
+    return m_Stats.Requested - m_Stats.Loaded - m_Stats.Failed - m_Stats.Cancelled;
+}
+
+void TextureLoader::Update()
+{
+    unsigned int uploaded = 0;
+    m_Stats.UploadsThisFrame = 0;
+
+    while (true)
+    {
+        Request request;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Decoded.empty())
+                break;
+
+            // The first upload of a frame always goes, however large, so big images still make progress
+            unsigned int size = m_Decoded.front().Width * m_Decoded.front().Height * 4;
+            if (uploaded > 0 && uploaded + size > m_UploadBudget)
+                break;
+
+            request = std::move(m_Decoded.front());
+            m_Decoded.pop_front();
+        }
+
+        std::shared_ptr<Texture> texture = request.Target.lock();
+        if (!texture)
+        {
+            m_Stats.Cancelled++;
+            stbi_image_free(request.Pixels);
+            continue;
+        }
+
+        if (!request.Pixels)
+        {
+            std::cout << "[TextureLoader] Could not load " << request.Path << ": " << request.Error << std::endl;
+            Finish(request, texture.get(), false);
+            continue;
+        }
+
+        Upload(*texture, request);
+        uploaded += request.Width * request.Height * 4;
+        m_Stats.UploadsThisFrame++;
+
+        Finish(request, texture.get(), true);
+    }
+}
+
+void TextureLoader::Upload(Texture& texture, const Request& request)
+{
+    unsigned int size = request.Width * request.Height * 4;
+
+    if (size > m_Staging.GetRegionSize())
+    {
+        texture.SetData(request.Width, request.Height, request.Pixels);
+    }
+    else
+    {
+        void* destination = m_Staging.Map(size);
+        memcpy(destination, request.Pixels, size);
+        unsigned int offset = m_Staging.Unmap();
+
+        m_Staging.Bind();
+        texture.SetData(request.Width, request.Height, (const void*)(uintptr_t)offset);
+        m_Staging.Unbind();
+    }
+
+    m_Stats.BytesUploaded += size;
+}
+
+void TextureLoader::Finish(Request& request, Texture* texture, bool loaded)
+{
+    stbi_image_free(request.Pixels);
+    request.Pixels = nullptr;
+
+    if (loaded)
+    {
+        double loadMs = std::chrono::duration<double, std::milli>(Clock::now() - request.Requested).count();
+
+        m_Stats.Loaded++;
+        m_Stats.DecodeMs += request.DecodeMs;
+        m_Stats.LoadMs += loadMs;
+        m_Stats.MaxLoadMs = std::max(m_Stats.MaxLoadMs, loadMs);
+    }
+    else
+        m_Stats.Failed++;
+
+    if (request.OnLoaded)
+        request.OnLoaded(*texture, loaded);
+}
+
+void TextureLoader::WorkerLoop()
+{
+    // Same orientation as Texture(path), without touching the global flag other threads read
+    stbi_set_flip_vertically_on_load_thread(1);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    while (true)
+    {
+        m_RequestAdded.wait(lock, [this] { return m_Quit || !m_Requests.empty(); });
+        if (m_Quit)
+            return;
+
+        Request request = std::move(m_Requests.front());
+        m_Requests.pop_front();
+        m_Decoding++;
+        lock.unlock();
+
+        // Nobody wants it any more, skip the decode and let Update() count it
+        if (!request.Target.expired())
+        {
+            auto start = Clock::now();
+            int channels;
+            request.Pixels = stbi_load(request.Path.c_str(), &request.Width, &request.Height, &channels, 4);
+            request.DecodeMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            if (!request.Pixels)
+                request.Error = stbi_failure_reason();
+        }
+
+        lock.lock();
+        m_Decoding--;
+        m_Decoded.push_back(std::move(request));
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "StreamingBuffer.hpp"
+#include "Texture.hpp"
+
+/*
+ Loads image files without freezing the render thread.
+
+ Load() returns right away with a Texture holding a 1x1 placeholder.
+ A pool of workers decodes the file with stb_image, and Update(), on the
+ GL thread once a frame, uploads decoded images through a
+ GL_PIXEL_UNPACK_BUFFER ring until the frame's byte budget is spent.
+ The upload respecifies the placeholder's own GL name, so the handle
+ (and anything that already holds it, like a batch's texture slots)
+ starts sampling the real image without being replaced.
+
+ One image larger than the budget still goes through, alone in its
+ frame, straight from client memory if it does not fit a ring region.
+
+ Dropping the last handle before the upload cancels the load. Callbacks
+ run on the GL thread inside Update(). Update() binds textures, so call
+ it before Renderer::InvalidateState().
+ */
+class TextureLoader
+{
+public:
+    using Callback = std::function<void(Texture& texture, bool loaded)>;
+
+    struct Stats
+    {
+        unsigned int Requested = 0;
+        unsigned int Loaded = 0;
+        unsigned int Failed = 0;
+        unsigned int Cancelled = 0;
+        unsigned int BytesUploaded = 0;
+        unsigned int UploadsThisFrame = 0;
+        double DecodeMs = 0.0;     // Summed over loaded textures, worker time
+        double LoadMs = 0.0;       // Summed over loaded textures, request to resident
+        double MaxLoadMs = 0.0;
+    };
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request
+    {
+        std::string Path;
+        std::weak_ptr<Texture> Target;
+        Callback OnLoaded;
+        Clock::time_point Requested;
+        double DecodeMs = 0.0;
+        unsigned char* Pixels = nullptr; // stbi_load output, null if decoding failed
+        const char* Error = nullptr;     // stb_image keeps its failure reason per thread
+        int Width = 0, Height = 0;
+    };
+
+    unsigned int m_UploadBudget;
+    StreamingBuffer m_Staging;
+
+    std::vector<std::thread> m_Workers;
+    std::mutex m_Mutex;
+    std::condition_variable m_RequestAdded;
+    std::deque<Request> m_Requests;  // Waiting for a worker
+    std::deque<Request> m_Decoded;   // Waiting for Update()
+    unsigned int m_Decoding;
+    bool m_Quit;
+
+    Stats m_Stats;
+
+public:
+    // `uploadBudget` bytes per frame, `workerCount` 0 for one less than the hardware threads
+    TextureLoader(unsigned int uploadBudget = 8 * 1024 * 1024, unsigned int workerCount = 0);
+    ~TextureLoader();
+
+    TextureLoader(const TextureLoader&) = delete;
+    TextureLoader& operator=(const TextureLoader&) = delete;
+
+    std::shared_ptr<Texture> Load(const std::string& filepath, Callback onLoaded = nullptr);
+
+    // Uploads what the workers finished, within the byte budget
+    void Update();
+
+    // Requested but not yet uploaded, failed or cancelled
+    unsigned int GetPending() const;
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    void Upload(Texture& texture, const Request& request);
+    void Finish(Request& request, Texture* texture, bool loaded);
+    void WorkerLoop();
+};
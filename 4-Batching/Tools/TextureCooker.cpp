@@ -0,0 +1,436 @@
+/*
+ Cooks an image into a .ctex (see TextureFile.hpp) so Texture can map
+ it and upload it as is: no PNG decode, no mip generation and a
+ quarter to an eighth of the VRAM of the RGBA8 it replaces.
+
+ - Channels come from the pixels, not the file: grey images become R8,
+   grey with alpha RG8, everything else RGBA8. Texture swizzles them
+   back to what sampling the PNG returned.
+ - Mip levels are box filtered down to 1x1 in linear light, color
+   weighted by alpha, and encoded back to sRGB. --linear skips the
+   conversion for data that is not color (masks, normal maps).
+ - --bc block compresses on the CPU: BC4 for grey, BC1 for opaque
+   color and BC3 for anything with alpha, 8 or 16 bytes per 4x4 block.
+   Endpoints come from the principal axis of each block's colors.
+
+ Rows are stored bottom-up, like Texture(path) flips them on load.
+
+ Build and run on Linux or macOS from 4-Batching:
+   g++ -std=gnu++17 -O2 Tools/TextureCooker.cpp TextureFile.cpp vendor/stb_image.cpp -o texture-cooker
+   ./texture-cooker --bc res/textures/gopher.png res/textures/gopher.ctex
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../TextureFile.hpp"
+#include "../vendor/stb_image.h"
+
+struct Options
+{
+    bool Compress = false;
+    bool Mips = true;
+    bool Linear = false;
+    std::string Input;
+    std::string Output;
+};
+
+// Straight alpha, color in linear light unless --linear
+struct Image
+{
+    int Width, Height;
+    std::vector<float> Pixels; // RGBA
+};
+
+static float s_ToLinear[256];
+
+static float toSrgb(float linear)
+{
+    linear = std::min(std::max(linear, 0.0f), 1.0f);
+    return linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+}
+
+static unsigned char quantize(float value)
+{
+    return (unsigned char)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+}
+
+static Image downsample(const Image& source)
+{
+    Image result;
+    result.Width = std::max(1, source.Width / 2);
+    result.Height = std::max(1, source.Height / 2);
+    result.Pixels.resize((size_t)result.Width * result.Height * 4);
+
+    for (int y = 0; y < result.Height; y++)
+    {
+        for (int x = 0; x < result.Width; x++)
+        {
+            float color[3] = { 0.0f, 0.0f, 0.0f }, plain[3] = { 0.0f, 0.0f, 0.0f };
+            float alpha = 0.0f;
+
+            // A 1 pixel wide source repeats its only row or column
+            for (int dy = 0; dy < 2; dy++)
+            {
+                for (int dx = 0; dx < 2; dx++)
+                {
+                    int sx = std::min(x * 2 + dx, source.Width - 1);
+                    int sy = std::min(y * 2 + dy, source.Height - 1);
+                    const float* pixel = &source.Pixels[((size_t)sy * source.Width + sx) * 4];
+
+                    for (int c = 0; c < 3; c++)
+                    {
+                        color[c] += pixel[c] * pixel[3];
+                        plain[c] += pixel[c];
+                    }
+                    alpha += pixel[3];
+                }
+            }
+
+            // Alpha weighted, so invisible texels do not darken the edges of visible ones
+            float* out = &result.Pixels[((size_t)y * result.Width + x) * 4];
+            for (int c = 0; c < 3; c++)
+                out[c] = alpha > 0.0f ? color[c] / alpha : plain[c] / 4.0f;
+            out[3] = alpha / 4.0f;
+        }
+    }
+
+    return result;
+}
+
+static std::vector<unsigned char> toRgba8(const Image& image, bool linear)
+{
+    std::vector<unsigned char> pixels(image.Pixels.size());
+    for (size_t i = 0; i < image.Pixels.size(); i++)
+    {
+        bool color = i % 4 != 3;
+        pixels[i] = quantize(color && !linear ? toSrgb(image.Pixels[i]) : image.Pixels[i]);
+    }
+
+    return pixels;
+}
+
+#pragma mark - Block compression
+
+static uint16_t to565(const float color[3])
+{
+    int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+    int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+    int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void from565(uint16_t packed, int color[3])
+{
+    color[0] = ((packed >> 11) & 31) * 255 / 31;
+    color[1] = ((packed >> 5) & 63) * 255 / 63;
+    color[2] = (packed & 31) * 255 / 31;
+}
+
+// BC1 color block, always in four color mode as BC3 requires
+static void encodeColorBlock(const unsigned char block[16][4], unsigned char* out)
+{
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int p = 0; p < 16; p++)
+        for (int c = 0; c < 3; c++)
+            mean[c] += block[p][c] / 16.0f;
+
+    float covariance[6] = {}; // rr rg rb gg gb bb
+    for (int p = 0; p < 16; p++)
+    {
+        float d[3] = { block[p][0] - mean[0], block[p][1] - mean[1], block[p][2] - mean[2] };
+        covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+    }
+
+    // A few power iterations find the principal axis well enough for 16 points
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int i = 0; i < 8; i++)
+    {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2]
+        };
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f)
+            break;
+        for (int c = 0; c < 3; c++)
+            axis[c] = next[c] / length;
+    }
+
+    float minimum = 0.0f, maximum = 0.0f;
+    for (int p = 0; p < 16; p++)
+    {
+        float t = (block[p][0] - mean[0]) * axis[0] + (block[p][1] - mean[1]) * axis[1] + (block[p][2] - mean[2]) * axis[2];
+        minimum = std::min(minimum, t);
+        maximum = std::max(maximum, t);
+    }
+
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++)
+    {
+        high[c] = mean[c] + axis[c] * maximum;
+        low[c] = mean[c] + axis[c] * minimum;
+    }
+
+    uint16_t color0 = to565(high), color1 = to565(low);
+    if (color0 < color1)
+        std::swap(color0, color1);
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        int palette[4][3];
+        from565(color0, palette[0]);
+        from565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        for (int p = 0; p < 16; p++)
+        {
+            int best = 0, bestDistance = INT32_MAX;
+            for (int i = 0; i < 4; i++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                    distance += (block[p][c] - palette[i][c]) * (block[p][c] - palette[i][c]);
+                if (distance < bestDistance)
+                {
+                    best = i;
+                    bestDistance = distance;
+                }
+            }
+            indices |= (uint32_t)best << (p * 2);
+        }
+    }
+
+    out[0] = color0 & 0xFF; out[1] = color0 >> 8;
+    out[2] = color1 & 0xFF; out[3] = color1 >> 8;
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+// BC4 block, also the alpha half of BC3: eight values between the extremes
+static void encodeValueBlock(const unsigned char values[16], unsigned char* out)
+{
+    unsigned char maximum = *std::max_element(values, values + 16);
+    unsigned char minimum = *std::min_element(values, values + 16);
+
+    int palette[8] = { maximum, minimum };
+    for (int i = 2; i < 8; i++)
+        palette[i] = ((8 - i) * maximum + (i - 1) * minimum) / 7;
+
+    uint64_t indices = 0;
+    if (maximum != minimum)
+    {
+        for (int p = 0; p < 16; p++)
+        {
+            int best = 0;
+            for (int i = 1; i < 8; i++)
+                if (std::abs(values[p] - palette[i]) < std::abs(values[p] - palette[best]))
+                    best = i;
+            indices |= (uint64_t)best << (p * 3);
+        }
+    }
+
+    out[0] = maximum;
+    out[1] = minimum;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+static std::vector<unsigned char> compress(const std::vector<unsigned char>& rgba, int width, int height, TextureFile::Format format)
+{
+    std::vector<unsigned char> result;
+    result.reserve(TextureFile::GetLevelSize(format, width, height));
+
+    for (int by = 0; by < height; by += 4)
+    {
+        for (int bx = 0; bx < width; bx += 4)
+        {
+            // Blocks past the edge repeat the last row and column
+            unsigned char block[16][4];
+            for (int p = 0; p < 16; p++)
+            {
+                int x = std::min(bx + p % 4, width - 1);
+                int y = std::min(by + p / 4, height - 1);
+                memcpy(block[p], &rgba[((size_t)y * width + x) * 4], 4);
+            }
+
+            unsigned char encoded[16];
+            unsigned char channel[16];
+
+            if (format == TextureFile::Format::BC4)
+            {
+                for (int p = 0; p < 16; p++)
+                    channel[p] = block[p][0];
+                encodeValueBlock(channel, encoded);
+                result.insert(result.end(), encoded, encoded + 8);
+            }
+            else if (format == TextureFile::Format::BC3)
+            {
+                for (int p = 0; p < 16; p++)
+                    channel[p] = block[p][3];
+                encodeValueBlock(channel, encoded);
+                encodeColorBlock(block, encoded + 8);
+                result.insert(result.end(), encoded, encoded + 16);
+            }
+            else
+            {
+                encodeColorBlock(block, encoded);
+                result.insert(result.end(), encoded, encoded + 8);
+            }
+        }
+    }
+
+    return result;
+}
+
+#pragma mark - Cooking
+
+static std::vector<unsigned char> encode(const std::vector<unsigned char>& rgba, int width, int height, TextureFile::Format format)
+{
+    if (TextureFile::IsCompressed(format))
+        return compress(rgba, width, height, format);
+
+    unsigned int channels = TextureFile::GetChannelCount(format);
+    std::vector<unsigned char> result((size_t)width * height * channels);
+
+    // R8 keeps red, RG8 red and alpha as its second channel
+    for (size_t p = 0; p < (size_t)width * height; p++)
+    {
+        for (unsigned int c = 0; c < channels; c++)
+            result[p * channels + c] = rgba[p * 4 + (channels == 2 && c == 1 ? 3 : c)];
+    }
+
+    return result;
+}
+
+static const char* formatName(TextureFile::Format format)
+{
+    switch (format)
+    {
+        case TextureFile::Format::R8:    return "R8";
+        case TextureFile::Format::RG8:   return "RG8";
+        case TextureFile::Format::RGBA8: return "RGBA8";
+        case TextureFile::Format::BC1:   return "BC1";
+        case TextureFile::Format::BC3:   return "BC3";
+        case TextureFile::Format::BC4:   return "BC4";
+    }
+    return "?";
+}
+
+static bool parseOptions(int argc, char** argv, Options& options)
+{
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+
+        if (argument == "--bc")             options.Compress = true;
+        else if (argument == "--no-mips")   options.Mips = false;
+        else if (argument == "--linear")    options.Linear = true;
+        else if (argument.compare(0, 2, "--") == 0)
+        {
+            std::cout << "Unknown option " << argument << std::endl;
+            return false;
+        }
+        else
+            files.push_back(argument);
+    }
+
+    if (files.size() != 2)
+        return false;
+
+    options.Input = files[0];
+    options.Output = files[1];
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        std::cout << "Usage: texture-cooker [--bc] [--no-mips] [--linear] <input image> <output.ctex>" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    int width, height, fileChannels;
+    stbi_set_flip_vertically_on_load(1);
+    unsigned char* pixels = stbi_load(options.Input.c_str(), &width, &height, &fileChannels, 4);
+    if (!pixels)
+    {
+        std::cout << "Could not load " << options.Input << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+
+    bool grey = true, alpha = false;
+    for (size_t p = 0; p < (size_t)width * height; p++)
+    {
+        const unsigned char* pixel = pixels + p * 4;
+        grey = grey && pixel[0] == pixel[1] && pixel[1] == pixel[2];
+        alpha = alpha || pixel[3] != 255;
+    }
+
+    TextureFile::Format format;
+    if (options.Compress)
+        format = grey && !alpha ? TextureFile::Format::BC4 : alpha ? TextureFile::Format::BC3 : TextureFile::Format::BC1;
+    else
+        format = grey ? (alpha ? TextureFile::Format::RG8 : TextureFile::Format::R8) : TextureFile::Format::RGBA8;
+
+    for (int i = 0; i < 256; i++)
+        s_ToLinear[i] = options.Linear ? i / 255.0f : (i <= 10 ? i / 255.0f / 12.92f : std::pow((i / 255.0f + 0.055f) / 1.055f, 2.4f));
+
+    Image image;
+    image.Width = width;
+    image.Height = height;
+    image.Pixels.resize((size_t)width * height * 4);
+    for (size_t i = 0; i < image.Pixels.size(); i++)
+        image.Pixels[i] = i % 4 == 3 ? pixels[i] / 255.0f : s_ToLinear[pixels[i]];
+
+    stbi_image_free(pixels);
+
+    std::vector<std::vector<unsigned char>> levels;
+    unsigned int bytes = 0, rgbaBytes = 0;
+
+    while (true)
+    {
+        // Level 0 goes through the float image as well, 8-bit sRGB round trips exactly
+        levels.push_back(encode(toRgba8(image, options.Linear), image.Width, image.Height, format));
+        bytes += (unsigned int)levels.back().size();
+        rgbaBytes += image.Width * image.Height * 4;
+
+        if (!options.Mips || (image.Width == 1 && image.Height == 1))
+            break;
+
+        image = downsample(image);
+    }
+
+    if (!TextureFile::Write(options.Output, format, width, height, levels))
+    {
+        std::cout << "Could not write " << options.Output << std::endl;
+        return 1;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << options.Input << " (" << width << "x" << height << ", " << fileChannels << " channels) -> "
+              << options.Output << ": " << formatName(format) << ", " << levels.size() << " levels, "
+              << bytes << " bytes (" << (float)rgbaBytes / bytes << "x smaller than RGBA8), "
+              << ms << " ms" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <chrono>
+
+// The compiler's own flags: glm only reports SSE2 when GLM_FORCE_INTRINSICS is set
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_SYSTEM_SSE 1
+#endif
+
+#include "TransformSystem.hpp"
+
+#include "JobSystem.hpp"
+
+// Below this many transforms splitting the work costs more than it saves
+static const uint32_t s_ParallelThreshold = 32768;
+// Multiple of 4 so only the last chunk has a scalar tail
+static const uint32_t s_ChunkSize = 16384;
+
+TransformSystem::TransformSystem(JobSystem* jobs)
+:   m_ViewProjection(1.0f),
+    m_Jobs(jobs)
+{
+}
+
+uint32_t TransformSystem::Add(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    m_PositionX.push_back(position.x);
+    m_PositionY.push_back(position.y);
+    m_PositionZ.push_back(position.z);
+    m_RotationX.push_back(rotation.x);
+    m_RotationY.push_back(rotation.y);
+    m_RotationZ.push_back(rotation.z);
+    m_RotationW.push_back(rotation.w);
+    m_ScaleX.push_back(scale.x);
+    m_ScaleY.push_back(scale.y);
+    m_ScaleZ.push_back(scale.z);
+
+    return GetCount() - 1;
+}
+
+void TransformSystem::Remove(uint32_t index)
+{
+    for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+                                           &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW,
+                                           &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+    {
+        (*component)[index] = component->back();
+        component->pop_back();
+    }
+}
+
+void TransformSystem::Clear()
+{
+    for (std::vector<float>* component : { &m_PositionX, &m_PositionY, &m_PositionZ,
+                                           &m_RotationX, &m_RotationY, &m_RotationZ, &m_RotationW,
+                                           &m_ScaleX, &m_ScaleY, &m_ScaleZ })
+        component->clear();
+}
+
+void TransformSystem::SetPosition(uint32_t index, const glm::vec3& position)
+{
+    m_PositionX[index] = position.x;
+    m_PositionY[index] = position.y;
+    m_PositionZ[index] = position.z;
+}
+
+void TransformSystem::SetRotation(uint32_t index, const glm::quat& rotation)
+{
+    m_RotationX[index] = rotation.x;
+    m_RotationY[index] = rotation.y;
+    m_RotationZ[index] = rotation.z;
+    m_RotationW[index] = rotation.w;
+}
+
+void TransformSystem::SetScale(uint32_t index, const glm::vec3& scale)
+{
+    m_ScaleX[index] = scale.x;
+    m_ScaleY[index] = scale.y;
+    m_ScaleZ[index] = scale.z;
+}
+
+glm::vec3 TransformSystem::GetPosition(uint32_t index) const
+{
+    return glm::vec3(m_PositionX[index], m_PositionY[index], m_PositionZ[index]);
+}
+
+void TransformSystem::Update(const glm::mat4& viewProjection)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    uint32_t count = GetCount();
+    m_World.resize(count);
+    m_MVP.resize(count);
+    m_ViewProjection = viewProjection;
+
+    if (count < s_ParallelThreshold || !m_Jobs || m_Jobs->GetThreadCount() == 1)
+    {
+        Compute(0, count);
+        m_Stats.Threads = 1;
+    }
+    else
+    {
+        // Split by whole chunks so every piece but the last starts and ends on a multiple of 4
+        m_Jobs->ParallelFor(0, (count + s_ChunkSize - 1) / s_ChunkSize, 1, [this, count](uint32_t begin, uint32_t end)
+        {
+            Compute(begin * s_ChunkSize, std::min(end * s_ChunkSize, count));
+        });
+        m_Stats.Threads = m_Jobs->GetThreadCount();
+    }
+
+    m_Stats.UpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TransformSystem::Compute(uint32_t begin, uint32_t end)
+{
+    const glm::mat4& vp = m_ViewProjection;
+    uint32_t i = begin;
+
+#ifdef TRANSFORM_SYSTEM_SSE
+    // Four transforms per iteration, one per lane: world = T * R * S and mvp = vp * world
+    __m128 vpColumns[4][4];
+    for (int column = 0; column < 4; column++)
+        for (int row = 0; row < 4; row++)
+            vpColumns[column][row] = _mm_set1_ps(vp[column][row]);
+
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 qx = _mm_loadu_ps(&m_RotationX[i]);
+        __m128 qy = _mm_loadu_ps(&m_RotationY[i]);
+        __m128 qz = _mm_loadu_ps(&m_RotationZ[i]);
+        __m128 qw = _mm_loadu_ps(&m_RotationW[i]);
+
+        __m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+        __m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+        __m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+        __m128 sx = _mm_loadu_ps(&m_ScaleX[i]);
+        __m128 sy = _mm_loadu_ps(&m_ScaleY[i]);
+        __m128 sz = _mm_loadu_ps(&m_ScaleZ[i]);
+
+        // world[column][row], the rotation as glm::mat3_cast builds it, columns scaled
+        __m128 world[4][4];
+        world[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        world[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        world[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        world[0][3] = zero;
+        world[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        world[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        world[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        world[1][3] = zero;
+        world[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        world[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        world[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        world[2][3] = zero;
+        world[3][0] = _mm_loadu_ps(&m_PositionX[i]);
+        world[3][1] = _mm_loadu_ps(&m_PositionY[i]);
+        world[3][2] = _mm_loadu_ps(&m_PositionZ[i]);
+        world[3][3] = one;
+
+        __m128 mvp[4][4];
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                __m128 sum = _mm_add_ps(_mm_mul_ps(vpColumns[0][row], world[column][0]),
+                                        _mm_mul_ps(vpColumns[1][row], world[column][1]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(vpColumns[2][row], world[column][2]));
+                mvp[column][row] = _mm_add_ps(sum, _mm_mul_ps(vpColumns[3][row], world[column][3]));
+            }
+        }
+
+        // Lane j of column c's four registers becomes column c of matrix i + j
+        for (int column = 0; column < 4; column++)
+        {
+            _MM_TRANSPOSE4_PS(world[column][0], world[column][1], world[column][2], world[column][3]);
+            _MM_TRANSPOSE4_PS(mvp[column][0], mvp[column][1], mvp[column][2], mvp[column][3]);
+
+            for (int lane = 0; lane < 4; lane++)
+            {
+                _mm_storeu_ps(&m_World[i + lane][column][0], world[column][lane]);
+                _mm_storeu_ps(&m_MVP[i + lane][column][0], mvp[column][lane]);
+            }
+        }
+    }
+#endif
+
+    for (; i < end; i++)
+    {
+        glm::quat rotation(m_RotationW[i], m_RotationX[i], m_RotationY[i], m_RotationZ[i]);
+        glm::mat3 basis = glm::mat3_cast(rotation);
+
+        glm::mat4& world = m_World[i];
+        world[0] = glm::vec4(basis[0] * m_ScaleX[i], 0.0f);
+        world[1] = glm::vec4(basis[1] * m_ScaleY[i], 0.0f);
+        world[2] = glm::vec4(basis[2] * m_ScaleZ[i], 0.0f);
+        world[3] = glm::vec4(m_PositionX[i], m_PositionY[i], m_PositionZ[i], 1.0f);
+
+        m_MVP[i] = vp * world;
+    }
+}
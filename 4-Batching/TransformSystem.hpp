@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "vendor/glm/glm.hpp"
+#include "vendor/glm/gtc/quaternion.hpp"
+
+class JobSystem;
+
+/*
+ Position, rotation and scale of many objects, turned into world and
+ model-view-projection matrices in bulk.
+
+ Every component lives in its own array (structure of arrays), so the
+ update loads four objects' x positions, four y positions and so on into
+ one SSE register each and builds four matrices at once, without the
+ shuffling an array of glm::mat4 would need. Only the finished matrices
+ are transposed into the usual glm::mat4 layout, ready for a uniform or
+ an instance buffer. The SSE path is compiled in wherever SSE2 is (every
+ x86-64 build); without it (ARM) the same loop runs scalar through glm.
+
+ Update() splits large counts into chunks run on the JobSystem, when
+ given one, and waits for them. Indices are stable until Remove(), which
+ moves the last transform into the freed index.
+ */
+class TransformSystem
+{
+public:
+    struct Stats
+    {
+        double UpdateMs = 0.0;       // Last Update(), wall clock
+        unsigned int Threads = 0;    // Threads that took part in it
+    };
+
+private:
+    std::vector<float> m_PositionX, m_PositionY, m_PositionZ;
+    std::vector<float> m_RotationX, m_RotationY, m_RotationZ, m_RotationW;
+    std::vector<float> m_ScaleX, m_ScaleY, m_ScaleZ;
+    std::vector<glm::mat4> m_World;
+    std::vector<glm::mat4> m_MVP;
+
+    // The update being worked on, read by the jobs
+    glm::mat4 m_ViewProjection;
+
+    JobSystem* m_Jobs;
+    Stats m_Stats;
+
+public:
+    // Without `jobs` every update runs on the calling thread
+    TransformSystem(JobSystem* jobs = nullptr);
+
+    TransformSystem(const TransformSystem&) = delete;
+    TransformSystem& operator=(const TransformSystem&) = delete;
+
+    // Index of the new transform
+    uint32_t Add(const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                 const glm::vec3& scale = glm::vec3(1.0f));
+    // Moves the last transform into `index`
+    void Remove(uint32_t index);
+    void Clear();
+
+    void SetPosition(uint32_t index, const glm::vec3& position);
+    void SetRotation(uint32_t index, const glm::quat& rotation);
+    void SetScale(uint32_t index, const glm::vec3& scale);
+    glm::vec3 GetPosition(uint32_t index) const;
+
+    // Recomputes every world and MVP matrix
+    void Update(const glm::mat4& viewProjection);
+
+    inline uint32_t GetCount() const { return (uint32_t)m_PositionX.size(); }
+    // As of the last Update()
+    inline const glm::mat4* GetWorldMatrices() const { return m_World.data(); }
+    inline const glm::mat4* GetMVPMatrices() const { return m_MVP.data(); }
+    inline const Stats& GetStats() const { return m_Stats; }
+
+private:
+    // Transforms [begin, end)
+    void Compute(uint32_t begin, uint32_t end);
+};
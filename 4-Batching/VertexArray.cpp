@@ -5,10 +5,13 @@
 //  Created by Ivan on 10.06.2022.
 //
 
+#include <cstdint>
+
 #include "VertexArray.hpp"
 #include "VertexBufferLayout.hpp"
 
 VertexArray::VertexArray()
+: m_AttribCount(0)
 {
     GLCall(glGenVertexArrays(1, &m_RendererID));
 }
@@ -31,19 +34,32 @@ void VertexArray::Unbind() const
 void VertexArray::AddBuffer(const VertexBuffer &vb, const VertexBufferLayout &layout)
 {
     Bind();
-    
     vb.Bind();
+    AddLayout(layout);
+}
+
+void VertexArray::AddBuffer(const StreamingBuffer &sb, const VertexBufferLayout &layout)
+{
+    Bind();
+    sb.Bind();
+    AddLayout(layout);
+}
+
+void VertexArray::AddLayout(const VertexBufferLayout &layout)
+{
     const auto& elements = layout.GetElements();
     unsigned int offset = 0;
     
     for (unsigned int i = 0; i < elements.size(); i++)
     {
         const auto& element = elements[i];
+        unsigned int location = m_AttribCount++;
         
-        GLCall(glEnableVertexAttribArray(i));
-        GLCall(glVertexAttribPointer(i, element.count, element.type,
+        GLCall(glEnableVertexAttribArray(location));
+        GLCall(glVertexAttribPointer(location, element.count, element.type,
                                      element.normalized, layout.GetStride(),
-                                     (const void*)offset));
+                                     (const void*)(uintptr_t)offset));
+        GLCall(glVertexAttribDivisor(location, element.divisor));
         
         offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
     }
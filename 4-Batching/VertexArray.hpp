@@ -7,6 +7,7 @@
 #pragma once
 
 #include "VertexBuffer.h"
+#include "StreamingBuffer.hpp"
 
 class VertexBufferLayout;
 
@@ -14,6 +15,8 @@ class VertexArray
 {
 private:
     unsigned int m_RendererID;
+    // Next free attribute location, buffers added later continue from here
+    unsigned int m_AttribCount;
     
 public:
     VertexArray();
@@ -22,6 +25,13 @@ public:
     void Bind() const;
     void Unbind() const;
     
+    inline unsigned int GetRendererID() const { return m_RendererID; }
+    
     void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
+    void AddBuffer(const StreamingBuffer& sb, const VertexBufferLayout& layout);
+    
+private:
+    // Points the next attribute locations at the buffer bound to GL_ARRAY_BUFFER
+    void AddLayout(const VertexBufferLayout& layout);
     
 };
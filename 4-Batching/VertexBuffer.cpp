@@ -5,22 +5,57 @@
 //  Created by Ivan on 10.06.2022.
 //
 
+#include <utility>
+
 #include "VertexBuffer.h"
 #include "Renderer.h"
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size)
+VertexBuffer::VertexBuffer(const void* data, unsigned int size, BufferUsage usage)
+: m_Size(size), m_Capacity(size), m_Usage(usage)
 {
     GLCall(glGenBuffers(1, &m_RendererID));
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
-    GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+    GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GetGLUsage(usage)));
     
 }
 
+VertexBuffer::VertexBuffer(unsigned int capacity, BufferUsage usage)
+: m_Size(0), m_Capacity(capacity), m_Usage(usage)
+{
+    GLCall(glGenBuffers(1, &m_RendererID));
+    GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
+    GLCall(glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GetGLUsage(usage)));
+}
+
 VertexBuffer::~VertexBuffer()
 {
+    // Deleting name 0 is a no-op, which covers moved-from buffers
     GLCall(glDeleteBuffers(1, &m_RendererID));
 }
 
+VertexBuffer::VertexBuffer(VertexBuffer&& other) noexcept
+: m_RendererID(std::exchange(other.m_RendererID, 0)),
+  m_Size(std::exchange(other.m_Size, 0)),
+  m_Capacity(std::exchange(other.m_Capacity, 0)),
+  m_Usage(other.m_Usage)
+{
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        GLCall(glDeleteBuffers(1, &m_RendererID));
+        
+        m_RendererID = std::exchange(other.m_RendererID, 0);
+        m_Size = std::exchange(other.m_Size, 0);
+        m_Capacity = std::exchange(other.m_Capacity, 0);
+        m_Usage = other.m_Usage;
+    }
+    
+    return *this;
+}
+
 void VertexBuffer::Bind() const
 {
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RendererID));
@@ -30,3 +65,58 @@ void VertexBuffer::Unbind() const
 {
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
+
+void VertexBuffer::SetData(const void* data, unsigned int size)
+{
+    if (size > m_Capacity)
+        m_Capacity = GrowCapacity(m_Capacity, size);
+    
+    Bind();
+    // Orphan the old storage so the driver does not wait for draws still reading it
+    GLCall(glBufferData(GL_ARRAY_BUFFER, m_Capacity, nullptr, GetGLUsage(m_Usage)));
+    GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
+    
+    m_Size = size;
+}
+
+void VertexBuffer::SetSubData(const void* data, unsigned int size, unsigned int offset)
+{
+    if (offset + size > m_Capacity)
+        Reserve(GrowCapacity(m_Capacity, offset + size));
+    
+    Bind();
+    GLCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+    
+    if (offset + size > m_Size)
+        m_Size = offset + size;
+}
+
+void VertexBuffer::Reserve(unsigned int capacity)
+{
+    if (capacity <= m_Capacity)
+        return;
+    
+    ReallocateBuffer(m_RendererID, m_Size, capacity, m_Usage);
+    m_Capacity = capacity;
+}
+
+void* VertexBuffer::Map(unsigned int offset, unsigned int size)
+{
+    if (offset + size > m_Capacity)
+        Reserve(GrowCapacity(m_Capacity, offset + size));
+    
+    if (offset + size > m_Size)
+        m_Size = offset + size;
+    
+    void* data;
+    Bind();
+    GLCall(data = glMapBufferRange(GL_ARRAY_BUFFER, offset, size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    return data;
+}
+
+void VertexBuffer::Unmap()
+{
+    Bind();
+    GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
+}
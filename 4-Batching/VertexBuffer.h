@@ -6,15 +6,47 @@
 //
 #pragma once
 
+#include "BufferUsage.hpp"
+
+/*
+ Owns one GL buffer name, so it can be moved but never copied. Writes past
+ the capacity grow the storage geometrically in place: the name stays the
+ same, so vertex arrays that already point at it keep working.
+ */
 class VertexBuffer
 {
 private:
     unsigned int m_RendererID;
+    unsigned int m_Size;
+    unsigned int m_Capacity;
+    BufferUsage m_Usage;
     
 public:
-    VertexBuffer(const void* data, unsigned int size);
+    VertexBuffer(const void* data, unsigned int size, BufferUsage usage = BufferUsage::STATIC);
+    // Empty buffer with room for `capacity` bytes, filled later through SetData
+    VertexBuffer(unsigned int capacity, BufferUsage usage = BufferUsage::DYNAMIC);
     ~VertexBuffer();
     
+    VertexBuffer(const VertexBuffer&) = delete;
+    VertexBuffer& operator=(const VertexBuffer&) = delete;
+    VertexBuffer(VertexBuffer&& other) noexcept;
+    VertexBuffer& operator=(VertexBuffer&& other) noexcept;
+    
+    // Replaces the whole contents, orphaning the old storage
+    void SetData(const void* data, unsigned int size);
+    // Overwrites [offset, offset + size) and keeps everything else
+    void SetSubData(const void* data, unsigned int size, unsigned int offset);
+    // Grows the storage to at least `capacity` bytes, keeping the contents
+    void Reserve(unsigned int capacity);
+    
+    // Write-only view of [offset, offset + size), valid until Unmap
+    void* Map(unsigned int offset, unsigned int size);
+    void Unmap();
+    
     void Bind() const;
     void Unbind() const;
+    
+    inline unsigned int GetSize() const { return m_Size; }
+    inline unsigned int GetCapacity() const { return m_Capacity; }
+    inline unsigned int GetRendererID() const { return m_RendererID; }
 };
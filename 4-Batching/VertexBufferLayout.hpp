@@ -11,11 +11,15 @@
 #include <glad/glad.h>
 #include "Renderer.h"
 
+#include "vendor/glm/glm.hpp"
+
 struct VertexBufferElement
 {
     unsigned int type;
     unsigned int count;
     bool normalized;
+    // 0 advances per vertex, N advances once every N instances
+    unsigned int divisor;
     
     static unsigned int GetSizeOfType(unsigned int type)
     {
@@ -38,10 +42,12 @@ class VertexBufferLayout
 private:
     std::vector<VertexBufferElement> m_Elements;
     unsigned int m_Stride;
+    unsigned int m_Divisor;
     
 public:
-    VertexBufferLayout()
-    : m_Stride(0)
+    // Pass a divisor of 1 for a per-instance layout
+    VertexBufferLayout(unsigned int divisor = 0)
+    : m_Stride(0), m_Divisor(divisor)
     {
         
     }
@@ -52,31 +58,42 @@ public:
         ASSERT(false);
     }
     
-    template<>
-    void Push<float>(unsigned int count)
-    {
-        m_Elements.push_back({ GL_FLOAT, count, false });
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_FLOAT);
-    }
-    
-    template<>
-    void Push<unsigned int>(unsigned int count)
-    {
-        m_Elements.push_back({ GL_UNSIGNED_INT, count, false });
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT);
-    }
-    
-    template<>
-    void Push<unsigned char>(unsigned int count)
-    {
-        m_Elements.push_back({ GL_UNSIGNED_BYTE, count, true });
-        m_Stride += count * VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE);
-    }
-    
     inline unsigned int GetStride() const
     { return m_Stride; }
     
-    inline const std::vector<VertexBufferElement> GetElements() const&
+    inline const std::vector<VertexBufferElement>& GetElements() const&
     { return m_Elements; }
+    
+private:
+    void PushElement(unsigned int type, unsigned int count, bool normalized)
+    {
+        m_Elements.push_back({ type, count, normalized, m_Divisor });
+        m_Stride += count * VertexBufferElement::GetSizeOfType(type);
+    }
 };
- 
+
+template<>
+inline void VertexBufferLayout::Push<float>(unsigned int count)
+{
+    PushElement(GL_FLOAT, count, false);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned int>(unsigned int count)
+{
+    PushElement(GL_UNSIGNED_INT, count, false);
+}
+
+template<>
+inline void VertexBufferLayout::Push<unsigned char>(unsigned int count)
+{
+    PushElement(GL_UNSIGNED_BYTE, count, true);
+}
+
+// An attribute is at most a vec4, so every matrix takes 4 consecutive locations
+template<>
+inline void VertexBufferLayout::Push<glm::mat4>(unsigned int count)
+{
+    for (unsigned int i = 0; i < count * 4; i++)
+        PushElement(GL_FLOAT, 4, false);
+}
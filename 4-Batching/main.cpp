@@ -19,6 +19,116 @@
  -    inside a vertex shader
  
  * 4. Implement imGui and feed translation matrices into it
+ 
+ * 5. Batching
+ -    BatchRenderer2D collects every quad of a frame into one
+ -    dynamic vertex buffer and draws them with as few
+ -    glDrawElements calls as possible. Up to
+ -    GL_MAX_TEXTURE_IMAGE_UNITS textures share one batch
+ -    through a sampler array. The stress scene throws tens of
+ -    thousands of sprites and many textures at it
+ 
+ * 6. Instancing
+ -    One quad, one glDrawElementsInstanced call and a buffer
+ -    of per-instance model matrices (attribute divisor 1)
+ 
+ * 7. Draw queue
+ -    Renderer::Submit records draws with a sort key and
+ -    Renderer::Flush runs them sorted by layer and state,
+ -    whatever order gameplay and UI submitted them in
+ 
+ * 8. GLCall cost
+ -    GLCALL_MODE compiles GLCall to the bare call (0),
+ -    glGetError checks (1) or KHR_debug call sites (2).
+ -    The benchmark scene times one draw under all three
+ 
+ * 9. Profiling
+ -    PROFILE_ZONE marks a scope on the CPU (steady_clock) and
+ -    on the GPU (timestamp queries read back a few frames
+ -    later). The Profiler window plots every zone, and
+ -    "Save trace" writes profile.json for chrome://tracing
+ 
+ * 10. Capture
+ -    FrameCapture reads the back buffer into a ring of pixel
+ -    pack buffers and writes PNGs on a worker thread once the
+ -    GPU is done, so recording does not stall the frame.
+ -    Recording writes raw frames, PNG encoding cannot keep up
+ 
+ * 11. Texture streaming
+ -    TextureLoader decodes images on worker threads and
+ -    uploads a few megabytes of them per frame through pixel
+ -    unpack buffers. Until then the texture is a grey 1x1
+ -    placeholder, so loading never holds up the first frame
+ 
+ * 12. Texture atlas
+ -    AtlasBuilder packs images into shared pages with
+ -    stb_rect_pack and extruded borders. With "Texture atlas"
+ -    the stress scene draws every sprite from one page, so
+ -    any number of textures still fits in a single batch
+ 
+ * 13. Cooked textures
+ -    Tools/TextureCooker bakes mips, the smallest of
+ -    R8/RG8/RGBA8 and optionally BC1/BC3/BC4 into a .ctex
+ -    file. Texture("*.ctex") maps it and uploads the levels
+ -    as they are, nothing is decoded at startup
+ 
+ * 14. Program binary cache
+ -    Linked programs are saved with glGetProgramBinary under
+ -    ShaderCache/ and reloaded with glProgramBinary on the
+ -    next launch, recompiling only when the driver rejects them
+ 
+ * 15. Shader hot reload
+ -    ShaderWatcher notices saved .shader files (inotify on
+ -    Linux), compiles them in the background and swaps the
+ -    program between frames if it links. Edit Shaders/ while
+ -    the demo runs, uniforms keep their values
+ 
+ * 16. Shader includes
+ -    ShaderParser reads a .shader file in one go and splits
+ -    it into vertex/geometry/fragment or compute stages.
+ -    #include pulls in shared .glsl files (cached, #line kept
+ -    right) and defines build permutations of one file
+ 
+ * 17. Resource manager
+ -    ResourceManager hands out generational handles to
+ -    textures, shaders and buffers, loads each path once and
+ -    counts references. Textures are kept to a video memory
+ -    budget, least recently used first, and come back on Get()
+ 
+ * 18. Transform system
+ -    TransformSystem keeps positions, rotations and scales
+ -    as separate arrays and builds world and MVP matrices
+ -    four at a time with SSE, over the job system for large
+ -    counts. The queued scene takes its MVPs from it
+ 
+ * 19. Entities
+ -    EntityStore groups entities by their set of components
+ -    and keeps every component in its own array. The gophers
+ -    are entities now: a colored quad with a textured child,
+ -    world transforms only rebuilt when something moved
+ 
+ * 20. Culling
+ -    Every sprite's bounding box sits in a SpatialGrid cell.
+ -    The map scene holds a million sprites, but only those
+ -    in cells overlapping the view are looked at and drawn
+ 
+ * 21. Cameras
+ -    OrthographicCamera/PerspectiveCamera cache view,
+ -    projection, their product and its inverse under a
+ -    version. The batch uniform, cull bounds, queued MVPs
+ -    and instanced uniform are only redone when it changes
+ 
+ * 22. Job system
+ -    JobSystem runs small jobs on worker threads, each with a
+ -    work stealing deque of its own. Counters track groups of
+ -    jobs and let jobs wait for others; ParallelFor splits a
+ -    range. The transform system runs its chunks on it
+ 
+ * 23. Parallel vertices
+ -    BatchRenderer2D::DrawQuads() picks texture slots on the
+ -    main thread, then jobs write each range of quads straight
+ -    into the mapped vertex buffer. The stress scene and the
+ -    entities draw through it, GL stays on the main thread
  */
 
 #pragma mark - Precompilation
@@ -26,20 +136,38 @@
 #define GL_SILENCE_DEPRECATION
 #define SIZE 50.0f
 #define VSYNC 1
+#define MAX_INSTANCES 100000
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <memory>
+#include <cmath>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "Renderer.h"
+#include "BatchRenderer2D.hpp"
+#include "AtlasBuilder.hpp"
+#include "GLCallBenchmark.hpp"
+#include "Profiler.hpp"
+#include "FrameCapture.hpp"
+#include "TextureLoader.hpp"
+#include "ResourceManager.hpp"
 #include "VertexBuffer.h"
 #include "IndexBuffer.hpp"
 #include "VertexBufferLayout.hpp"
 #include "VertexArray.hpp"
 #include "Shader.hpp"
+#include "ShaderWatcher.hpp"
 #include "Texture.hpp"
+#include "JobSystem.hpp"
+#include "TransformSystem.hpp"
+#include "EntityStore.hpp"
+#include "Camera.hpp"
 
 #include "vendor/glm/gtc/matrix_transform.hpp"
 #include "vendor/imgui/imgui.h"
@@ -52,6 +180,132 @@ void Cb(int code, const char* message)
 }
 
 
+#pragma mark - Scenes
+enum class Scene
+{ GOPHERS = 0, STRESS = 1, INSTANCED = 2, QUEUED = 3, GLCALL_COST = 4, MAP = 5 };
+
+struct Sprite
+{
+    glm::vec3 Position;
+    glm::vec2 Size;
+    glm::vec4 Color;
+    int       TextureIndex; // -1 for a flat colored quad
+};
+
+std::vector<Sprite> createSprites(int count, int textureCount)
+{
+    std::mt19937 rng(1337);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<int> texture(-1, textureCount - 1);
+    
+    std::vector<Sprite> sprites(count);
+    for (Sprite& sprite : sprites)
+    {
+        sprite.Position = { position(rng), position(rng), 0.0f };
+        sprite.Size     = glm::vec2(0.5f + unit(rng));
+        sprite.Color    = { unit(rng), unit(rng), unit(rng), 1.0f };
+        sprite.TextureIndex = texture(rng);
+    }
+    
+    return sprites;
+}
+
+// Small 8x8 checkerboards in distinct colors
+std::vector<std::vector<unsigned char>> createCheckerboards(int count)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> channel(64, 255);
+    
+    std::vector<std::vector<unsigned char>> checkerboards;
+    for (int i = 0; i < count; i++)
+    {
+        std::vector<unsigned char> pixels(8 * 8 * 4);
+        unsigned char r = channel(rng), g = channel(rng), b = channel(rng);
+        
+        for (int p = 0; p < 8 * 8; p++)
+        {
+            bool dark = ((p % 8) / 2 + (p / 8) / 2) % 2;
+            pixels[p * 4 + 0] = dark ? r / 2 : r;
+            pixels[p * 4 + 1] = dark ? g / 2 : g;
+            pixels[p * 4 + 2] = dark ? b / 2 : b;
+            pixels[p * 4 + 3] = 255;
+        }
+        
+        checkerboards.push_back(std::move(pixels));
+    }
+    
+    return checkerboards;
+}
+
+// Every checkerboard is a separate binding
+std::vector<std::unique_ptr<Texture>> createTextures(int count)
+{
+    std::vector<std::unique_ptr<Texture>> textures;
+    for (const std::vector<unsigned char>& pixels : createCheckerboards(count))
+        textures.push_back(std::make_unique<Texture>(8, 8, pixels.data()));
+    
+    return textures;
+}
+
+// The same checkerboards packed on one page, keyed by index
+std::unique_ptr<AtlasBuilder> createAtlas(int count)
+{
+    auto atlas = std::make_unique<AtlasBuilder>(1024, 1);
+    
+    std::vector<std::vector<unsigned char>> checkerboards = createCheckerboards(count);
+    for (int i = 0; i < count; i++)
+        atlas->Add(std::to_string(i), 8, 8, checkerboards[i].data());
+    
+    atlas->Build();
+    return atlas;
+}
+
+// Side of the square map, about one sprite per four square units
+float getMapSize(int count)
+{
+    return std::sqrt(count * 4.0f);
+}
+
+std::vector<Entity> createMap(EntityStore& entities, int count, const std::vector<std::unique_ptr<Texture>>& textures)
+{
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> position(0.0f, getMapSize(count));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<int> texture(-1, (int)textures.size() - 1);
+    
+    entities.Clear();
+    
+    std::vector<Entity> sprites(count);
+    for (Entity& sprite : sprites)
+    {
+        sprite = entities.Create();
+        entities.AddTransform(sprite, { { position(rng), position(rng), 0.0f }, unit(rng) * 6.2831853f });
+        
+        int index = texture(rng);
+        entities.AddSprite(sprite, { glm::vec2(0.5f + unit(rng)), index >= 0 ? textures[index].get() : nullptr });
+        entities.AddColor(sprite, { { unit(rng), unit(rng), unit(rng), 1.0f } });
+    }
+    
+    return sprites;
+}
+
+std::vector<glm::mat4> createInstanceTransforms(int count)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(0.0f, 100.0f);
+    
+    std::vector<glm::mat4> transforms(count);
+    for (glm::mat4& transform : transforms)
+    {
+        transform = glm::translate(glm::mat4(1.0f), glm::vec3(position(rng), position(rng), 0.0f));
+        transform = glm::scale(transform, glm::vec3(0.05f));
+    }
+    
+    return transforms;
+}
+
+
 #pragma mark - OpenGL hints
 #pragma region GLFWHints {
 void setOpenGLEnviroment()
@@ -60,6 +314,9 @@ void setOpenGLEnviroment()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#if GLCALL_MODE == 2
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+#endif
     
     glfwSetErrorCallback(Cb);
 }
@@ -96,60 +353,102 @@ int main(void)
     int status = gladLoadGL();
     std::cout << "GLad status: " << status << std::endl;
     
+#if GLCALL_MODE == 2
+    if (!GLEnableDebugOutput())
+        std::cout << "KHR_debug unavailable, GLCall polls glGetError" << std::endl;
+#endif
     
-    float vertexBuffer[] = {
-        -SIZE/2, -SIZE/2, 0.0f, 0.0f, // 0
-         SIZE/2, -SIZE/2, 1.0f, 0.0f, // 1
-         SIZE/2,  SIZE/2, 1.0f, 1.0f, // 2
-        -SIZE/2,  SIZE/2, 0.0f, 1.0f // 3
-    };
     
-    unsigned int indexBuffer[] = {
-        0, 1, 2,
-        2, 3, 0,
-    };
+    // Before the first Shader is built
+    Shader::SetBinaryCacheDirectory("ShaderCache");
+    ShaderWatcher shaderWatcher;
     
+    GLCall(glEnable(GL_BLEND));
     GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
     
-    VertexArray va;
-    
-    VertexBuffer vb(vertexBuffer, 4 * 4 * sizeof(float));
-    IndexBuffer ib(indexBuffer, 6);
-    
-    glm::mat4 proj = glm::ortho(0.0f, 100.0f, 0.0f, 100.0f, -1.0f, 1.0f);
-    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 0));
-    
-    VertexBufferLayout layout;
-    layout.Push<float>(2);
-    layout.Push<float>(2);
-    
-    va.AddBuffer(vb, layout);
+    // Whatever depends on a camera remembers the version it was built from
+    OrthographicCamera camera(0.0f, 100.0f, 0.0f, 100.0f);
     
+    // Shared by every system that splits its work, this thread takes part too
+    JobSystem jobs;
     
-    Shader shader("Shaders/Basic.shader");
-    shader.Bind();
+    Renderer renderer;
+    BatchRenderer2D batch(renderer);
+    bool parallelVertices = true;
+    batch.SetJobSystem(&jobs);
     
     
-#pragma mark - Passing color from CPU via Uniform
+#pragma mark - Passing color from CPU via vertices
     float red = 0.41f;
     float green = 0.84f;
     float blue = 0.88f;
     float alpha = 1.0f;
     
-    shader.SetUniform4f("u_Color", red, green, blue, alpha);
-    
 #pragma mark - Draw loop
     
-    Texture texture("res/textures/gopher.png");
-    texture.Bind();
+    TextureLoader loader;
+    int textureBudgetMb = 256;
+    ResourceManager resources(&loader, (uint64_t)textureBudgetMb * 1024 * 1024);
+    TextureHandle gopher = resources.LoadTexture("res/textures/gopher.png");
+    
+#pragma mark - Instanced gopher
+    float quadVertices[] = {
+        -SIZE/2, -SIZE/2, 0.0f, 0.0f, // 0
+         SIZE/2, -SIZE/2, 1.0f, 0.0f, // 1
+         SIZE/2,  SIZE/2, 1.0f, 1.0f, // 2
+        -SIZE/2,  SIZE/2, 0.0f, 1.0f  // 3
+    };
+    
+    unsigned int quadIndices[] = {
+        0, 1, 2,
+        2, 3, 0,
+    };
+    
+    VertexArray instancedVa;
+    VertexBuffer quadVb(quadVertices, 4 * 4 * sizeof(float));
+    IndexBuffer quadIb(quadIndices, 6);
+    // Starts empty, SetData grows it as the instance count goes up
+    VertexBuffer instanceVb(0, BufferUsage::DYNAMIC);
+    
+    VertexBufferLayout quadLayout;
+    quadLayout.Push<float>(2);
+    quadLayout.Push<float>(2);
+    instancedVa.AddBuffer(quadVb, quadLayout);
+    
+    VertexBufferLayout instanceLayout(1);
+    instanceLayout.Push<glm::mat4>(1);
+    instancedVa.AddBuffer(instanceVb, instanceLayout);
+    instancedVa.Unbind();
+    
+    Shader& instancedShader = *resources.Get(resources.LoadShader("Shaders/Instanced.shader"));
+    instancedShader.Bind();
+    instancedShader.SetUniform1i("u_Texture", 0);
+    instancedShader.Unbind();
+    
+    UniformHandle instancedColor = instancedShader.GetUniformHandle("u_Color"_uniform);
+    UniformHandle instancedViewProjection = instancedShader.GetUniformHandle("u_ViewProjection"_uniform);
+    uint64_t instancedCameraVersion = 0;
+    
+#pragma mark - Queued gophers
+    VertexArray quadVa;
+    quadVa.AddBuffer(quadVb, quadLayout);
+    quadVa.Unbind();
+    
+    // Same source, separate programs: UI_PASS draws UI half transparent over gameplay
+    Shader& gameShader = *resources.Get(resources.LoadShader("Shaders/Basic.shader"));
+    Shader& uiShader = *resources.Get(resources.LoadShader("Shaders/Basic.shader", { "UI_PASS" }));
+    for (Shader* shader : { &gameShader, &uiShader })
+    {
+        shader->Bind();
+        shader->SetUniform1i("u_Texture", 0);
+        shader->SetUniform4f("u_Color", red, green, blue, alpha);
+    }
+    uiShader.Unbind();
     
-    shader.SetUniform1i("u_Texture", 0);
+    UniformHandle gameMVP = gameShader.GetUniformHandle("u_MVP"_uniform);
+    UniformHandle uiMVP = uiShader.GetUniformHandle("u_MVP"_uniform);
     
-    // Drop
-    shader.Unbind();
-    va.Unbind();
-    vb.Unbind();
-    ib.Unbind();
+    std::vector<std::unique_ptr<Texture>> queueTextures = createTextures(4);
     
     std::cout << "Version: " << glGetString(GL_VERSION) << std::endl;
     std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
@@ -157,8 +456,6 @@ int main(void)
     
     float modifier = 1.1f;
     
-    Renderer renderer;
-    
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -168,36 +465,257 @@ int main(void)
     
     ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
     
-    glm::vec3 translation1(50, 0, 0);
-    glm::vec3 translation2(90, 0, 0);
+    // Each gopher is a colored quad with the textured quad as its child
+    EntityStore entities;
+    std::vector<Entity> gophers;
+    std::vector<Entity> gopherImages;
+    for (glm::vec3 position : { glm::vec3(50, 0, 0), glm::vec3(90, 0, 0) })
+    {
+        Entity body = entities.Create();
+        entities.AddTransform(body, { position });
+        entities.AddSprite(body, { glm::vec2(SIZE, SIZE) });
+        entities.AddColor(body);
+        
+        Entity image = entities.Create();
+        entities.SetParent(image, body);
+        entities.AddSprite(image, { glm::vec2(SIZE, SIZE) });
+        
+        gophers.push_back(body);
+        gopherImages.push_back(image);
+    }
+    float gopherRotation = 0.0f;
+    
+    // Far larger than the view, the camera slider scrolls through it
+    EntityStore mapEntities;
+    std::vector<Entity> mapSprites;
+    std::vector<std::unique_ptr<Texture>> mapTextures = createTextures(8);
+    int mapSpriteCount = 1000000;
+    int mapMoving = 1000;
+    OrthographicCamera mapCamera(0.0f, 100.0f, 0.0f, 100.0f);
+    glm::vec2 mapScroll(0.0f);
+    bool mapCulling = true;
+    std::mt19937 mapRng(5);
+    
+    Scene scene = Scene::GOPHERS;
+    int spriteCount = 50000;
+    int textureCount = 16;
+    std::vector<Sprite> sprites;
+    std::vector<std::unique_ptr<Texture>> spriteTextures;
+    bool useAtlas = false;
+    std::unique_ptr<AtlasBuilder> spriteAtlas;
+    std::vector<const AtlasBuilder::Region*> spriteRegions;
+    int instanceCount = 10000;
+    int uploadedInstances = 0;
+    int queuedCount = 500;
+    TransformSystem queuedTransforms(&jobs);
+    uint64_t queuedCameraVersion = 0;
+    bool deferred = true;
+    int benchmarkDraws = 2000;
+    GLCallBenchmarkResult benchmark = {};
+    double submitMs = 0.0;
+    
+    Profiler profiler;
+    FrameCapture capture;
+    bool screenshot = false;
+    bool recording = false;
+    int recordedFrames = 0;
     
     while (!glfwWindowShouldClose(window))
     {
+        profiler.BeginFrame();
+        
         renderer.Clear();
         
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
         
-        shader.Bind();
-        shader.SetUniform4f("u_Color", red, green, blue, alpha);
+        Scene activeScene = scene;
         
         {
-            glm::mat4 model = glm::translate(glm::mat4(1.0f), translation1);
-            glm::mat4 mvp = proj * view * model;
-            shader.SetUniformMat4f("u_MVP", mvp);
+            PROFILE_ZONE("Update");
+            
+            loader.Update();
+            shaderWatcher.Update();
+            resources.SetTextureBudget((uint64_t)textureBudgetMb * 1024 * 1024);
+            resources.Update();
+            
+            if (activeScene == Scene::STRESS && ((int)sprites.size() != spriteCount || (int)spriteTextures.size() != textureCount))
+            {
+                spriteTextures = createTextures(textureCount);
+                sprites = createSprites(spriteCount, textureCount);
+                
+                spriteAtlas = createAtlas(textureCount);
+                spriteRegions.clear();
+                for (int i = 0; i < textureCount; i++)
+                    spriteRegions.push_back(spriteAtlas->Find(std::to_string(i)));
+            }
+            
+            if (activeScene == Scene::QUEUED)
+            {
+                if ((int)queuedTransforms.GetCount() != queuedCount)
+                {
+                    queuedTransforms.Clear();
+                    for (int i = 0; i < queuedCount; i++)
+                    {
+                        glm::vec3 position(5.0f + (i % 25) * 3.8f, 5.0f + (i / 25 % 25) * 3.8f, 0.0f);
+                        queuedTransforms.Add(position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.06f));
+                    }
+                    queuedCameraVersion = 0;
+                }
+                
+                // The objects stand still, only the camera can invalidate their MVPs
+                if (queuedCameraVersion != camera.GetVersion())
+                {
+                    queuedTransforms.Update(camera.GetViewProjection());
+                    queuedCameraVersion = camera.GetVersion();
+                }
+            }
+            
+            if (activeScene == Scene::MAP)
+            {
+                if ((int)mapSprites.size() != mapSpriteCount)
+                    mapSprites = createMap(mapEntities, mapSpriteCount, mapTextures);
+                
+                // Only a new version if the slider moved
+                mapCamera.SetPosition(glm::vec3(mapScroll, 0.0f));
+                
+                // Random sprites wander, the grid only hears about those
+                std::uniform_real_distribution<float> wander(-0.5f, 0.5f);
+                for (int i = 0; i < mapMoving; i++)
+                {
+                    Entity sprite = mapSprites[mapRng() % mapSprites.size()];
+                    glm::vec3 position = mapEntities.GetTransform(sprite)->Position;
+                    mapEntities.SetPosition(sprite, position + glm::vec3(wander(mapRng), wander(mapRng), 0.0f));
+                }
+                
+                mapEntities.UpdateTransforms();
+            }
             
-            renderer.Draw(va, ib, shader);
+            // Instance transforms only change with the count, not per frame
+            if (activeScene == Scene::INSTANCED && uploadedInstances != instanceCount)
+            {
+                std::vector<glm::mat4> transforms = createInstanceTransforms(instanceCount);
+                instanceVb.SetData(transforms.data(), instanceCount * sizeof(glm::mat4));
+                uploadedInstances = instanceCount;
+            }
         }
         
+        // ImGui and the resource updates above bind behind the renderer's back
+        renderer.InvalidateState();
+        
+        // Only valid for this frame, the manager may evict and reload it in between
+        Texture& texture = *resources.Get(gopher);
+        renderer.ResetStats();
+        
+        auto submitStart = std::chrono::steady_clock::now();
+        
+        batch.ResetStats();
+        batch.Begin(activeScene == Scene::MAP ? mapCamera : camera);
+        
+        if (activeScene == Scene::STRESS)
         {
-        glm::mat4 model = glm::translate(glm::mat4(1.0f), translation2);
-        glm::mat4 mvp = proj * view * model;
-        shader.SetUniformMat4f("u_MVP", mvp);
+            batch.DrawQuads((uint32_t)sprites.size(), [&](uint32_t i) -> const Texture*
+            {
+                const Sprite& sprite = sprites[i];
+                if (sprite.TextureIndex < 0)
+                    return nullptr;
+                if (useAtlas)
+                    return &spriteAtlas->GetPage(spriteRegions[sprite.TextureIndex]->Page);
+                return spriteTextures[sprite.TextureIndex].get();
+            },
+            [&](uint32_t i, float texIndex, QuadVertex* vertices)
+            {
+                const Sprite& sprite = sprites[i];
+                if (sprite.TextureIndex >= 0 && useAtlas)
+                {
+                    const AtlasBuilder::Region& region = *spriteRegions[sprite.TextureIndex];
+                    BatchRenderer2D::WriteQuad(vertices, sprite.Position, sprite.Size, sprite.Color, texIndex,
+                                               region.UVMin, region.UVMax);
+                }
+                else
+                    BatchRenderer2D::WriteQuad(vertices, sprite.Position, sprite.Size, sprite.Color, texIndex);
+            });
+        }
+        else if (activeScene == Scene::GOPHERS)
+        {
+            for (Entity gopher : gophers)
+                entities.GetColor(gopher)->Color = glm::vec4(red, green, blue, alpha);
+            for (Entity image : gopherImages)
+                entities.GetSprite(image)->Texture = &texture;
+            
+            entities.UpdateTransforms();
+            entities.DrawSprites(batch);
+        }
+        else if (activeScene == Scene::MAP)
+        {
+            PROFILE_ZONE("Map");
+            
+            if (mapCulling)
+                mapEntities.DrawSprites(batch, mapCamera);
+            else
+                mapEntities.DrawSprites(batch);
+        }
+        
+        batch.End();
+        
+        if (activeScene == Scene::INSTANCED)
+        {
+            PROFILE_ZONE("Instanced");
+            
+            renderer.BindShader(instancedShader);
+            instancedShader.SetUniform4f(instancedColor, red, green, blue, alpha);
+            if (instancedCameraVersion != camera.GetVersion())
+            {
+                instancedShader.SetUniformMat4f(instancedViewProjection, camera.GetViewProjection());
+                instancedCameraVersion = camera.GetVersion();
+            }
+            renderer.BindTexture(texture, 0);
+            
+            renderer.DrawInstanced(instancedVa, quadIb, instancedShader, instanceCount);
+        }
         
-        renderer.Draw(va, ib, shader);
+        if (activeScene == Scene::QUEUED)
+        {
+            PROFILE_ZONE("Queued");
+            
+            // Interleaved on purpose: every third object is UI, textures rotate
+            for (int i = 0; i < queuedCount; i++)
+            {
+                bool ui = i % 3 == 0;
+                const Shader& shader = ui ? uiShader : gameShader;
+                const Texture& objectTexture = *queueTextures[i % queueTextures.size()];
+                const glm::mat4& mvp = queuedTransforms.GetMVPMatrices()[i];
+                
+                if (deferred)
+                {
+                    renderer.Submit(quadVa, quadIb, shader, &objectTexture, mvp, ui ? 1 : 0);
+                }
+                else
+                {
+                    renderer.BindShader(shader);
+                    renderer.BindTexture(objectTexture, 0);
+                    shader.SetUniformMat4f(ui ? uiMVP : gameMVP, mvp);
+                    renderer.Draw(quadVa, quadIb, shader);
+                }
+            }
+            
+            renderer.Flush();
         }
         
+        if (activeScene == Scene::GLCALL_COST)
+        {
+            PROFILE_ZONE("GLCall benchmark");
+            
+            glm::mat4 mvp = camera.GetViewProjection() * glm::translate(glm::mat4(1.0f), entities.GetTransform(gophers[0])->Position);
+            benchmark = RunGLCallBenchmark(quadVa, quadIb, gameShader, mvp, benchmarkDraws);
+            
+            // The benchmark binds directly
+            renderer.InvalidateState();
+        }
+        
+        submitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+        
         if (modifier > 0.0f) // ascending
         {
             if (green >= 1.0f) modifier = -0.05f;
@@ -214,18 +732,102 @@ int main(void)
         }
         
         ImGui::Begin("Hello, world!");
-        ImGui::SliderFloat3("Translation 1", &translation1.x, 0.0f, 100.0f);
-        ImGui::SliderFloat3("Translation 2", &translation2.x, 0.0f, 100.0f);
+        for (size_t i = 0; i < gophers.size(); i++)
+        {
+            glm::vec3 position = entities.GetTransform(gophers[i])->Position;
+            if (ImGui::SliderFloat3(("Translation " + std::to_string(i + 1)).c_str(), &position.x, 0.0f, 100.0f))
+                entities.SetPosition(gophers[i], position);
+        }
+        if (ImGui::SliderAngle("Gopher rotation", &gopherRotation))
+        {
+            for (Entity gopher : gophers)
+                entities.SetRotation(gopher, gopherRotation);
+        }
+        ImGui::RadioButton("Gophers", (int*)&scene, (int)Scene::GOPHERS); ImGui::SameLine();
+        ImGui::RadioButton("Stress", (int*)&scene, (int)Scene::STRESS); ImGui::SameLine();
+        ImGui::RadioButton("Instanced", (int*)&scene, (int)Scene::INSTANCED); ImGui::SameLine();
+        ImGui::RadioButton("Queued", (int*)&scene, (int)Scene::QUEUED); ImGui::SameLine();
+        ImGui::RadioButton("GLCall cost", (int*)&scene, (int)Scene::GLCALL_COST); ImGui::SameLine();
+        ImGui::RadioButton("Map", (int*)&scene, (int)Scene::MAP);
+        ImGui::SliderInt("Sprites", &spriteCount, 1000, 500000);
+        ImGui::SliderInt("Textures", &textureCount, 1, 256);
+        ImGui::Checkbox("Texture atlas", &useAtlas); ImGui::SameLine();
+        if (ImGui::Checkbox("Parallel vertices", &parallelVertices))
+            batch.SetJobSystem(parallelVertices ? &jobs : nullptr);
+        ImGui::SliderInt("Instances", &instanceCount, 1, MAX_INSTANCES);
+        ImGui::SliderInt("Queued objects", &queuedCount, 1, 625);
+        ImGui::Checkbox("Deferred submission", &deferred);
+        ImGui::SliderInt("Benchmark draws", &benchmarkDraws, 100, 20000);
+        ImGui::SliderInt("Map sprites", &mapSpriteCount, 100000, 4000000);
+        ImGui::SliderInt("Moving sprites", &mapMoving, 0, 20000);
+        ImGui::SliderFloat2("Camera", &mapScroll.x, 0.0f, getMapSize(mapSpriteCount) - 100.0f);
+        ImGui::Checkbox("Culling", &mapCulling);
+        ImGui::Text("Map: %u visible, %u culled, %u cells visited",
+                    mapEntities.GetStats().SpritesDrawn, mapEntities.GetStats().SpritesCulled,
+                    mapEntities.GetSpatialIndex().GetStats().CellsVisited);
+        ImGui::Text("GLCALL_MODE %d, ns/draw: bare %.0f, glGetError %.0f, KHR_debug %.0f%s",
+                    GLCALL_MODE, benchmark.Bare, benchmark.GetError, benchmark.DebugOutput,
+                    benchmark.DebugOutputAvailable ? "" : " (fallback)");
+        ImGui::Text("Jobs: %u threads, %llu run, %llu stolen, %llu inline", jobs.GetThreadCount(),
+                    (unsigned long long)jobs.GetStats().Executed, (unsigned long long)jobs.GetStats().Stolen,
+                    (unsigned long long)jobs.GetStats().Inline);
+        ImGui::Text("Texture slots per batch: %u", batch.GetTextureSlotCount());
+        ImGui::Text("Draw calls: %u, quads: %u", renderer.GetStats().DrawCalls, batch.GetStats().QuadCount);
+        ImGui::Text("State changes: %u issued, %u skipped", renderer.GetStats().StateChanges, renderer.GetStats().StateChangesSkipped);
+        ImGui::Text("Batch submit %.3f ms/frame", submitMs);
+        ImGui::Text("Entities: %u in %u archetypes, %u transforms updated, %u sprites drawn",
+                    entities.GetStats().Entities, entities.GetStats().Archetypes,
+                    entities.GetStats().TransformsUpdated, entities.GetStats().SpritesDrawn);
         ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+        ImGui::Text("Shader cache: %u hits (%.1f ms), %u compiled (%.1f ms), %u rejected",
+                    Shader::GetCacheStats().Hits, Shader::GetCacheStats().LoadMs, Shader::GetCacheStats().Misses,
+                    Shader::GetCacheStats().CompileMs, Shader::GetCacheStats().Rejected);
+        ImGui::Text("Shader reloads: %u, %u failed, %u compiling%s", shaderWatcher.GetStats().Reloads,
+                    shaderWatcher.GetStats().Failures, shaderWatcher.GetCompiling(),
+                    shaderWatcher.HasParallelCompile() ? " (parallel)" : "");
+        ImGui::Text("Textures: %u loaded, %u pending, load %.1f ms max, decode %.1f ms total",
+                    loader.GetStats().Loaded, loader.GetPending(), loader.GetStats().MaxLoadMs, loader.GetStats().DecodeMs);
+        ImGui::SliderInt("Texture budget (MB)", &textureBudgetMb, 0, 1024);
+        ImGui::Text("Resources: textures %.1f MB (%u, %u cached), shaders %.1f KB, buffers %.1f KB, %u hits, %u evicted",
+                    resources.GetStats().TextureBytes / (1024.0 * 1024.0), resources.GetStats().Textures,
+                    resources.GetStats().CachedTextures, resources.GetStats().ShaderBytes / 1024.0,
+                    resources.GetStats().BufferBytes / 1024.0, resources.GetStats().Hits, resources.GetStats().Evictions);
+        screenshot = ImGui::Button("Screenshot"); ImGui::SameLine();
+        ImGui::Checkbox("Record frames", &recording);
+        ImGui::Text("Captures: %u written, %u in flight, %u stalls, %u queue stalls", capture.GetStats().Written.load(),
+                    capture.GetInFlight(), capture.GetStats().Stalls, capture.GetStats().QueueStalls);
         ImGui::End();
         
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.DrawImGui();
+        
+        {
+            PROFILE_ZONE("ImGui");
+            
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        
+        // After ImGui so it is in the picture, before the swap so GL_BACK still holds the frame
+        if (screenshot || recording)
+        {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            
+            if (screenshot)
+                capture.Capture("screenshot.png", FrameCapture::Format::PNG, width, height);
+            if (recording)
+                capture.Capture("frame_" + std::to_string(recordedFrames++) + ".rgba", FrameCapture::Format::RAW, width, height);
+        }
+        capture.Update();
+        
+        profiler.EndFrame();
         
         GLCall(glfwSwapBuffers(window));
         GLCall(glfwPollEvents());
     }
     
+    capture.Finish();
+    
     ImGui_ImplOpenGL3_Shutdown();
     GLCall(glfwTerminate());
     